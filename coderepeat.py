@@ -42,6 +42,12 @@ def run_preprocessor(args, intermediary):
         pre_args.append('--symlinks')
     if args.delcmts:
         pre_args.append('--delete-comments');
+    if args.tokens:
+        pre_args += ['--tokens', "{}.tokens".format(intermediary)]
+    elif args.sparse:
+        pre_args += ['--bounds', "{}.bounds".format(intermediary)]
+        if args.sparse == 'lines':
+            pre_args.append('--bounds-lines')
     run(pre_args)
 
 
@@ -52,21 +58,58 @@ def run_findrepset(args, intermediary):
     ]
     if not args.supermax:
         base_cmd.append("-nm"),  # find maximal repeats, not supermaximal ones
+    if args.sais:
+        base_cmd.append("-sais")
+    if args.threads > 1:
+        base_cmd += ["-threads", str(args.threads)]
+    if args.mem_budget:
+        base_cmd += ["--mem-budget", args.mem_budget]
+    if args.low_mem and not (args.tokens or args.sparse or args.file_separators):
+        base_cmd.append("--low-mem")
+    # filtered before they are written; the "post" step still checks blank and null after splitting
+    if args.minocc:
+        base_cmd += ["-minocc", str(args.minocc)]
+    if args.maxocc:
+        base_cmd += ["-maxocc", str(args.maxocc)]
+    if args.minlines:
+        base_cmd += ["-minlines", str(args.minlines)]
+    if args.skip_blank:
+        base_cmd.append("-noblank")
+    if args.skip_null:
+        base_cmd.append("-nonull")
+    if args.maxrepeat and not args.tokens:
+        base_cmd += ["-maxl", str(args.maxrepeat)]
+    if args.tokens:
+        base_cmd += ["-tok", "{}.tokens".format(intermediary)]
+        if args.parameterized:
+            base_cmd.append("-param")
+    elif args.sparse:
+        base_cmd += ["-sparse", "{}.bounds".format(intermediary)]
+    elif args.file_separators:
+        base_cmd += ["-files", "{}.charmap".format(intermediary)]
+    elif args.index:
+        base_cmd += ["-idx", "{}.idx".format(intermediary)]
+    if args.binary and not args.tokens:
+        base_cmd.append("-b")
     concat_in = "{}.concat".format(intermediary)
     if args.compress:
         base_cmd.append(concat_in)
         cmd = " ".join([shlex.quote(c) for c in base_cmd]) + " -o /dev/fd/1 | gzip -c > " + shlex.quote(
-            "{}.output.txt.gz".format(intermediary))
+            findrepset_output(args, intermediary))
         print("Running '" + cmd + "'...")
         subprocess.run(cmd, shell=True, check=True)
     else:
-        run([*base_cmd, "-o", "{}.output.txt".format(intermediary), concat_in])
+        run([*base_cmd, "-o", findrepset_output(args, intermediary), concat_in])
+
+
+def findrepset_output(args, intermediary):
+    return "{}.output.{}{}".format(intermediary, "bin" if args.binary and not args.tokens else "txt", ".gz" if args.compress else "")
 
 
 def run_postprocessor(args, intermediary, output):
     post_args = [
         "{}/bin/postprocessor".format(args.prefix),
-        ("{}.output.txt.gz" if args.compress else "{}.output.txt").format(intermediary),
+        findrepset_output(args, intermediary),
         "{}.charmap".format(intermediary),
         "{}.linemap".format(intermediary),
         output.name,
@@ -78,6 +121,12 @@ def run_postprocessor(args, intermediary, output):
         post_args.append('--skip-null')
     if args.compress:
         post_args.append('--compress')
+    if args.tokens:
+        post_args += ['--tokens', "{}.tokens.map".format(intermediary)]
+    elif args.binary:
+        post_args += ['--concat', "{}.concat".format(intermediary)]
+    if args.file_separators and not args.sparse and not args.tokens:
+        post_args.append('--whole-files')
     run(post_args)
 
 
@@ -121,6 +170,9 @@ def parse_args():
                              help='List of steps to run')
     parser.add_argument('-m', '--min-repeat-length', dest="minrepeat", type=unsigned_int, default=10,
                              help='Minimum size of the repeated sequences')
+    parser.add_argument('-M', '--max-repeat-length', dest="maxrepeat", type=unsigned_int, default=0,
+                             help='Cut longer repeats to this size, sorting the input only that deep '
+                                  '(default: 0, no limit; ignored with --tokens)')
     parser.add_argument('-i', '--intermediaries',
                              help='Output directory for intermediary files (default: regular output directory)')
     pre_group = parser.add_argument_group('Pre-processing', 'Options for the "pre" step. '
@@ -140,6 +192,44 @@ def parse_args():
                            help='Remove c-style comments from the source code')
     find_group = parser.add_argument_group('Repeat Finding', 'Options for the "findmaxrep" step.')
     find_group.add_argument('--supermax', action='store_true', help='Use supermaximal repeats')
+    find_group.add_argument('--sais', action='store_true',
+                            help='Build the suffix array with the linear-time SA-IS engine (default: prefix doubling)')
+    find_group.add_argument('--threads', type=unsigned_int, default=1,
+                            help='Number of threads used to build the suffix array (default: 1)')
+    find_group.add_argument('--mem-budget', dest='mem_budget',
+                            help='RAM for the suffix and LCP arrays, e.g. 8G; the rest is mapped to temporary files '
+                                 'and built with sequential passes (the text must still fit in RAM)')
+    find_group.add_argument('--low-mem', dest='low_mem', action='store_true',
+                            help='Reuse the buffers between phases to peak at about 9 bytes per input byte, '
+                                 'showing the peak of each phase (implies --sais; ignored with --sparse, '
+                                 '--file-separators and --tokens)')
+    find_group.add_argument('--index', action='store_true',
+                            help='Keep the suffix and LCP arrays in an index file next to the intermediaries '
+                                 'and reuse it while the concatenated input is unchanged')
+    find_group.add_argument('--binary', action='store_true',
+                            help='Pass the repeats to the "post" step as a compact binary stream '
+                                 'instead of text')
+    find_group.add_argument('--sparse', choices=['tokens', 'lines'],
+                            help='Only find repeats starting at a token or line start, indexing just those '
+                                 'positions (needs the "pre" step to run with the same option; no --index)')
+    find_group.add_argument('--file-separators', dest='file_separators', action='store_true',
+                            help='Separate the files with distinct symbols so no repeat spans two of them; '
+                                 'the "post" step then skips splitting and merging (not with --sparse or --index)')
+    find_group.add_argument('--tokens', action='store_true',
+                            help='Lex the sources (C, C++, Java) into tokens and find the repeats over them; '
+                                 'repeats never span files (needs the "pre" step to run with the same option; '
+                                 'overrides --binary, --sparse, --file-separators and --index)')
+    find_group.add_argument('--parameterized', action='store_true',
+                            help='Also report the token repeats that only differ in a consistent renaming of '
+                                 'the identifiers (implies --tokens)')
+    find_group.add_argument('--min-occurrences', dest='minocc', type=unsigned_int, default=0,
+                            help='Only report the repeats found at least this many times (counted before they '
+                                 'are split at file boundaries; exact with --file-separators or --tokens)')
+    find_group.add_argument('--max-occurrences', dest='maxocc', type=unsigned_int, default=0,
+                            help='Only report the repeats found at most this many times (0: no limit; counted '
+                                 'as --min-occurrences)')
+    find_group.add_argument('--min-lines', dest='minlines', type=unsigned_int, default=0,
+                            help='Only report the repeats spanning at least this many lines')
     post_group = parser.add_argument_group('Post-processing', 'Options for the "post" step')
     post_group.add_argument('--skip-blank', dest='skip_blank', action='store_true',
                             help='Skip repeated sequences that only contain whitespace and control code'
@@ -148,7 +238,10 @@ def parse_args():
                             help='Skip repeated sequences that only contain null (default: false)')
     parser.set_defaults(launch=run_scan)
 
-    return parser.parse_args()
+    args = parser.parse_args()
+    if args.parameterized:
+        args.tokens = True
+    return args
 
 
 def main():
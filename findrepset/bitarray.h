@@ -11,7 +11,7 @@ typedef word_type bitarray;
 #define log_word_size 5
 #define log_word_size_mask (ba_word_size-1)
 #define bita_declare(ba, n) bitarray ba[((uint64)(n) + (uint64)ba_word_size - 1LL) / (uint64)ba_word_size]
-#define bita_malloc(size) ((word_type*)pz_malloc((((size)+ba_word_size-1) & ~(uint)(ba_word_size-1))))
+#define bita_malloc(size) ((word_type*)pz_malloc((((size_t)(size)+ba_word_size-1) / ba_word_size) * sizeof(word_type)))
 
 #define bita_clear(ba, n)  memset(ba, 0x00, ((n) + 7)/8)
 #define bita_setall(ba, n) memset(ba, 0xFF, ((n) + 7)/8)
@@ -1,131 +1,126 @@
 #include "bittree.h"
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
-#include "tipos.h"
 #include "macros.h"
 
-#define IS_LEFT_CHILD(i) ((~i)&1)
-#define IS_RIGHT_CHILD(i) (i&1)
-#define LEFT_CHILD(i) (i<<1)
-#define RIGHT_CHILD(i) ((i<<1)|1)
-#define PARENT(i) (i>>1)
+#define WORD(i) ((i) >> 6)
+#define BIT(i) (1ULL << ((i) & 63))
+/* Words of the level with n bits. Each level has one more, always 0,
+ * where bittree_min_greater_than() may step past the last one. */
+#define NWORDS(n) (((n) + 63) >> 6)
 
-bittree* bittree_malloc(uint n) {
-	uint i, logn = 1;
-	for(i=1;i<n;i<<=1) ++logn;
-	bittree* tree = (bittree*)pz_malloc(logn * sizeof(word_type*));
-	forn(i,logn) {
-		tree[i]=bita_malloc(n);
-		n = (n>>1)+(n&1);
-	}
-	assert(n==1);
+#ifdef HAVE___BUILTIN_CLZLL
+#define bt_hi(x) (63 - (uint)__builtin_clzll(x))
+#define bt_lo(x) ((uint)__builtin_ctzll(x))
+#else
+static inline uint bt_hi(uint64 x) { uint b = 0; while (x >>= 1) ++b; return b; }
+static inline uint bt_lo(uint64 x) { uint b = 0; while (!(x & 1)) { x >>= 1; ++b; } return b; }
+#endif
+
+bittree* bittree_malloc(uidx n) {
+	bittree* tree = (bittree*)pz_malloc(sizeof(bittree));
+	tree->nl = 0;
+	do {
+		n = NWORDS(n);
+		tree->lv[tree->nl++] = (uint64*)pz_malloc((n + 1) * sizeof(uint64));
+	} while (n > 1);
+	assert(tree->nl <= BITTREE_MAXL);
 	return tree;
 }
 
-void bittree_free(bittree* tree, uint n) {
-	uint i, logn = 1;
-	for(i=1;i<n;i*=2) ++logn;
-	forn(i,logn) pz_free(tree[i]);
+void bittree_free(bittree* tree, uidx n) {
+	uint k;
+	(void)n;
+	forn(k, tree->nl) pz_free(tree->lv[k]);
 	pz_free(tree);
 }
 
-void bittree_clear(bittree* tree, uint n) {
-	uint i, j, logn = 1;
-	for(i=1;i<n;i<<=1) ++logn;
-	forn(i,logn) {
-		forn(j,(n+ba_word_size-1)/ba_word_size) tree[i][j]=0;
-		n = (n>>1)+(n&1);
+void bittree_clear(bittree* tree, uidx n) {
+	uint k;
+	forn(k, tree->nl) {
+		n = NWORDS(n);
+		memset(tree->lv[k], 0, (n + 1) * sizeof(uint64));
 	}
-	assert(n==1);
 }
 
-void bittree_preset(bittree* tree, uint n, uint i) {
-	bita_set(tree[0],i);
+void bittree_preset(bittree* tree, uidx n, uidx i) {
+	(void)n;
+	tree->lv[0][WORD(i)] |= BIT(i);
 }
 
-void bittree_endset(bittree* tree, uint n) {
-	uint i, j, logn = 1;
-	for(i=1;i<n;i<<=1) ++logn;
-	forn(i,logn-1) {
-		forn(j,n) if (bita_get(tree[i],j)) {
-			bita_set(tree[i+1],PARENT(j));
-		}
-		n = (n>>1)+(n&1);
+void bittree_endset(bittree* tree, uidx n) {
+	uidx w;
+	uint k;
+	forn(k, tree->nl-1) {
+		n = NWORDS(n);
+		forn(w, n) if (tree->lv[k][w]) tree->lv[k+1][WORD(w)] |= BIT(w);
 	}
 }
 
-void bittree_set(bittree* tree, uint n, uint i) {
-	uint j, logn = 1;
-	for(j=1;j<n;j<<=1) ++logn;
-	bita_set(tree[0],i);
-	forsn(j,1,logn) {
-		i>>=1;
-		if (bita_get(tree[j],i)) break;
-		bita_set(tree[j],i);
+void bittree_set(bittree* tree, uidx n, uidx i) {
+	uint64 x;
+	uint k;
+	(void)n;
+	forn(k, tree->nl) {
+		x = tree->lv[k][WORD(i)];
+		tree->lv[k][WORD(i)] = x | BIT(i);
+		/* the levels above already know this word */
+		if (x) break;
+		i = WORD(i);
 	}
 }
 
-
-uint bittree_max_less_than(bittree* tree, uint n, uint i) {
-	assert(0 <= (i) && (i) < n);
-//	assert(!bita_get(tree[0],i));
-	uint l = 0;
-	while (!bita_get(tree[l],i)) {
-		if (IS_LEFT_CHILD(i)) {
-			i = i-1;
-		} else {
-			i = PARENT(i);
-			++l;
-		}
+uidx bittree_max_less_than(bittree* tree, uidx n, uidx i) {
+	uint64 m;
+	uint k = 0;
+	(void)n;
+	assert(i < n);
+	/* up to the first word with an item <= i */
+	for(;;) {
+		/* the bits up to i; 2 << 63 is 0, all of them */
+		m = tree->lv[k][WORD(i)] & ((2ULL << (i & 63)) - 1);
+		if (m) break;
+		if (i < 64 || ++k == tree->nl) return 0;
+		i = WORD(i) - 1;
 	}
-	while(l>0) {
-		if (bita_get(tree[l-1],RIGHT_CHILD(i))) {
-			i = RIGHT_CHILD(i);
-		} else {
-			i = LEFT_CHILD(i);
-		}
-		--l;
+	i = (i & ~(uidx)63) + bt_hi(m);
+	/* and down by the last item of each word */
+	while (k) {
+		--k;
+		i = (i << 6) + bt_hi(tree->lv[k][i]);
 	}
 	return i;
 }
 
-uint bittree_min_greater_than(bittree* tree, uint n, uint i) {
-	assert(0 <= (i) && (i) < n);
-//	assert(!bita_get(tree[0],i));
-	uint l = 0;
-	while (!bita_get(tree[l],i)) {
-		if (IS_RIGHT_CHILD(i)) {
-			i = i+1;
-		} else {
-			i = PARENT(i);
-			++l;
-		}
+uidx bittree_min_greater_than(bittree* tree, uidx n, uidx i) {
+	uint64 m;
+	uint k = 0;
+	assert(i < n);
+	for(;;) {
+		m = tree->lv[k][WORD(i)] & (~0ULL << (i & 63));
+		if (m) break;
+		if (++k == tree->nl) return n;
+		i = WORD(i) + 1;
 	}
-	while(l>0) {
-		if (bita_get(tree[l-1],LEFT_CHILD(i))) {
-			i = LEFT_CHILD(i);
-		} else {
-			i = RIGHT_CHILD(i);
-		}
-		--l;
+	i = (i & ~(uidx)63) + bt_lo(m);
+	while (k) {
+		--k;
+		i = (i << 6) + bt_lo(tree->lv[k][i]);
 	}
 	return i;
 }
 
 
-void bittree_show(bittree* tree, uint n) {
-	uint i,j,k,sp = 1,logn = 1;
-	for(j=1;j<n;j<<=1) ++logn;
-	forn(k,logn) {
-		forn(j,sp/2) printf(" ");
-		forn(i,n) {
-			printf("%d", bita_get(tree[k],i));
-			forn(j,sp) printf(" ");
-		}
+void bittree_show(bittree* tree, uidx n) {
+	uidx i;
+	uint k;
+	forn(k, tree->nl) {
+		forn(i, n) printf("%d", (int)((tree->lv[k][WORD(i)] >> (i & 63)) & 1));
 		printf("\n");
-		sp = 2*sp+1;
-		n = (n>>1)+(n&1);
+		n = NWORDS(n);
 	}
 }
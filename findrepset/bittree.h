@@ -1,24 +1,35 @@
 #ifndef __BITTREE_H__
 #define __BITTREE_H__
 
-#include "bitarray.h"
+#include "tipos.h"
 
-typedef word_type* bittree;
+/** Set of integers in [0, n) with predecessor and successor queries.
+ * The level 0 has a bit per item in 64-bit words, and each level above a
+ * bit per word of the one below, set iff that word is not 0. A query goes
+ * up until a word has a set bit on the right side and down again, with a
+ * clz or ctz per level: O(log64 n), the upper levels staying in cache.
+ */
+#define BITTREE_MAXL 11
+
+typedef struct {
+	uint nl;                       /* levels, the last one a single word */
+	uint64* lv[BITTREE_MAXL];
+} bittree;
 
-bittree* bittree_malloc(uint n);
-void bittree_free(bittree* tree, uint n);
-void bittree_clear(bittree* tree, uint n);
-void bittree_preset(bittree* tree, uint n, uint i);
-void bittree_endset(bittree* tree, uint n);
-void bittree_set(bittree* tree, uint n, uint i);
-//void unset(bittree* tree, uint i);
-/*IMPORTANT NOTE: if there is no item less than/greater than i, the results
- *are unpredictable
+bittree* bittree_malloc(uidx n);
+void bittree_free(bittree* tree, uidx n);
+void bittree_clear(bittree* tree, uidx n);
+/* Sets i in level 0 only: call bittree_endset() after the last one */
+void bittree_preset(bittree* tree, uidx n, uidx i);
+void bittree_endset(bittree* tree, uidx n);
+void bittree_set(bittree* tree, uidx n, uidx i);
+//void unset(bittree* tree, uidx i);
+/* The largest item <= i and the smallest one >= i. If there is none they
+ * give 0 and n respectively.
  */
-uint bittree_max_less_than(bittree* tree, uint n, uint i);
-uint bittree_min_greater_than(bittree* tree, uint n, uint i);
+uidx bittree_max_less_than(bittree* tree, uidx n, uidx i);
+uidx bittree_min_greater_than(bittree* tree, uidx n, uidx i);
 
-void bittree_show(bittree* tree, uint n);
+void bittree_show(bittree* tree, uidx n);
 
 #endif //__BITTREE_H__
-
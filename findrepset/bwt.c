@@ -1,5 +1,5 @@
 #include "bwt.h"
-#include "sorters.h"
+#include "radix.h"
 #include "macros.h"
 
 #include <stdlib.h>
@@ -9,145 +9,173 @@
 #define BSORTBITS 16
 #define BSORTSIZE (64*1024) /* 2^BSORTBITS */
 
-/* Parallel sort */
-#ifdef BWT_PSORT
 #include "psort.h"
-psort bwt_ps;
-#endif
-
-static __thread uint n;   /* largo de la entrada  */
-static __thread uint* p;  /* numero de posicion actual de cada rotacion */
-static __thread uint* r;  /* permutación resultado con el orden */
-static __thread uint t;   /* 2^(numero de pasos) */
-static __thread uint* bc; /* memoria para el bucket sort */
-static __thread uint64* qm;/* memoria para el qsort por copia */
 
+/* Estado de una llamada a bwt(), uno por thread */
+typedef struct {
+	uidx n;    /* largo de la entrada  */
+	uidx* p;   /* numero de posicion actual de cada rotacion */
+	uidx* r;   /* permutación resultado con el orden */
+	uidx t;    /* caracteres por los que ya esta ordenado */
+	uidx* kb;  /* la clave de la rotacion x es kb[(x+ks)%n]: p en el */
+	uidx ks;   /* caso secuencial, una copia de p corrida en t si no */
+	uidx* bc;  /* memoria para el bucket sort */
+	qpair* qm; /* memoria para el radix sort por copia (qpair en radix.h) */
+	qpair* qt; /* y su espacio auxiliar */
+	uidx maxdepth; /* ver bwt_opts */
+} bwt_ctx;
+
+/* Copia a locales los campos que usa KEY(): p es del mismo tipo y el
+ * compilador no puede asumir que escribirlo no los cambia */
+#define KEY_VARS uidx *kb = c->kb, ks = c->ks, n = c->n
+#define KEY(x) (kb[((x)+ks)%n])
+
+/* Rango [b, e) de r que refina un thread, alineado a buckets */
+typedef struct {
+	bwt_ctx* ctx; /* uno por thread */
+	uidx b, e, nb;
+} bwt_chunk;
+
+/* Hace otra ronda si los primeros t caracteres no alcanzan */
+#define bwt_deeper(c, t) (!(c)->maxdepth || (t) < (c)->maxdepth)
 
 /*** DEBUG functions ***/
-void show(uchar* s, uint* r);
+void show(bwt_ctx* c, uchar* s);
 
 /*** Prototypes: sorters ***/
-static void internal_bsort(uint* b, uint* e);
-static inline void internal_sort_M32(uint* b, uint* e);
-void internal_qsort3(uint* b, uint* e);
+static void internal_bsort(bwt_ctx* c, uidx* b, uidx* e);
+static inline void internal_sort_M32(bwt_ctx* c, uidx* b, uidx* e);
+static void internal_sort_keys(bwt_ctx* c, uidx* b, uidx* e);
 
-static inline void fix_index(uint *b, uint *e);
+static inline void fix_index(bwt_ctx* c, uidx *b, uidx *e);
 
 
 /*** Sorters ***/
 
 #define SWAP(a,b) {*(a)^=*(b); *(b)^=*(a); *(a)^=*(b);}
 
-/*** Macro de bucket-sort, para lo y hi ***/
-#define internal_bsort_partial(name, yyy, xxx) \
-void name(uint* b, uint* e) { \
-	uint *pp, *np; \
-	uint i,y; \
-	if (e-b < 2) return; \
-	forn(i,BSORTSIZE) bc[i]=0; \
-	forsn(pp,b,e) bc[(yyy p[((*pp)+t)%n]) xxx]++; \
-	y = bc[0] != 0; \
-	forsn(i,1,BSORTSIZE) { y+=bc[i]!=0; bc[i]+=bc[i-1]; } \
-	if (y <= 1) return; /* hay un sólo bucket, no way */ \
-	for(pp=b;pp!=e;) { \
-		y = (yyy p[((*pp)+t)%n]) xxx; \
-		np = b+(bc[y]-1); \
-		if (np > pp) { \
-			SWAP(pp,np); \
-			--bc[y]; \
-		} else { \
-			++pp; \
-		} \
-	} \
+/*** Bucket-sort por el digito de BSORTBITS bits que empieza en el bit sh ***/
+static void internal_bsort_digit(bwt_ctx* c, uidx* b, uidx* e, uint sh) {
+	uidx *pp, *np;
+	uidx i,y;
+	uidx* bc = c->bc;
+	KEY_VARS;
+	if (e-b < 2) return;
+	forn(i,BSORTSIZE) bc[i]=0;
+	forsn(pp,b,e) bc[(KEY(*pp) >> sh) & (BSORTSIZE-1)]++;
+	y = bc[0] != 0;
+	forsn(i,1,BSORTSIZE) { y+=bc[i]!=0; bc[i]+=bc[i-1]; }
+	if (y <= 1) return; /* hay un sólo bucket, no way */
+	for(pp=b;pp!=e;) {
+		y = (KEY(*pp) >> sh) & (BSORTSIZE-1);
+		np = b+(bc[y]-1);
+		if (np > pp) {
+			SWAP(pp,np);
+			--bc[y];
+		} else {
+			++pp;
+		}
+	}
 }
 
-int check_invariant(void) {
-	uint *c, bq=0;
-	uint *b=r, *e=r+n;
-	for(c = b; c < e; ++c) {
-		if (p[*c] > c-b) {
-			fprintf(stderr, "** Bucket %u starts at position %u (%u positions before)\n", p[*c], (uint)(c-b), p[*c]-(uint)(c-b));
+int check_invariant(bwt_ctx* c) {
+	uidx *x, bq=0;
+	uidx *p=c->p, *b=c->r, *e=c->r+c->n;
+	for(x = b; x < e; ++x) {
+		if (p[*x] > x-b) {
+			fprintf(stderr, "** Bucket "UIDX_FMT" starts at position "UIDX_FMT" ("UIDX_FMT" positions before)\n", p[*x], (uidx)(x-b), p[*x]-(uidx)(x-b));
 			exit(1);
 			return 0;
 		}
-		if (p[*c] != bq) {
-			if (p[*c] != c-b) {
-				fprintf(stderr, "** New bucket %u starts, but at position %u (last bucket: %u)\n", p[*c], (uint)(c-b), bq);
+		if (p[*x] != bq) {
+			if (p[*x] != x-b) {
+				fprintf(stderr, "** New bucket "UIDX_FMT" starts, but at position "UIDX_FMT" (last bucket: "UIDX_FMT")\n", p[*x], (uidx)(x-b), bq);
 				exit(1);
 				return 0;
 			}
-			bq = p[*c];
+			bq = p[*x];
 		}
 	}
 	return 1;
 }
 
-/*** Instanciaciones del bsort, para lo y hi ***/
-internal_bsort_partial(internal_bsort_hi, , >> BSORTBITS)
-internal_bsort_partial(internal_bsort_lo, ,& (BSORTSIZE-1))
-
-/*** BSORT de indices sobre la estructura de 2 arrays ***/
-void internal_bsort(uint* b, uint* e) {
-	uint* pp, *ee = e;
-	uint pb;
-	internal_bsort_hi(b,e);
+/*** Ordena por los digitos desde el bit sh hacia abajo, de a BSORTBITS ***/
+static void internal_bsort_rec(bwt_ctx* c, uidx* b, uidx* e, uint sh) {
+	uidx* pp;
+	uidx pb;
+	KEY_VARS;
+	internal_bsort_digit(c,b,e,sh);
+	if (!sh) return;
 	for(pp = e-1; b < e; e = pp+1) {
-		pb = p[((*pp)+t)%n] >> BSORTBITS;
-		while(b <= pp && ((p[((*pp)+t)%n] >> BSORTBITS) == pb)) --pp;
+		pb = KEY(*pp) >> sh;
+		while(b <= pp && ((KEY(*pp) >> sh) == pb)) --pp;
 		if (e-pp < QSORTUB) {
-//			internal_sort_M32(pp+1,e);
-			internal_qsort3(pp+1,e);
+			internal_sort_keys(c,pp+1,e);
 		} else {
-			internal_bsort_lo(pp+1,e);
+			internal_bsort_rec(c,pp+1,e,sh-BSORTBITS);
 		}
 	}
-	fix_index(b, ee);
-//	check_invariant();
 }
 
-/*** QSORT de indices sobre la estructura de 2 arrays ***/
-#define _VAL(X) (p[(*(X)+t)%n])
-_def_qsort3(internal_qsort3, uint, uint, _VAL, <)
-#undef _VAL
-
-/*** QSORT de indices que copia a otra estructura en un vector de elementos de 64bits. ***/
-#define val_qsortM32(X) ((uint)*(X))
-_def_qsort3(internal_qsortM32, uint64, uint, val_qsortM32, <)
-
-static inline void internal_sort_M32(uint* b, uint* e) {
-	uint *c, np, vl, nvl, d;
-	uint mn = e-b;
-	uint64 *mu = qm;
-	for(c=b; c!=e; ++c, ++mu) {
-		*mu = (uint64)(p[((*c)+t)%n]) | ((uint64)*c << 32);
+/*** BSORT de indices sobre la estructura de 2 arrays ***/
+static void internal_bsort(bwt_ctx* c, uidx* b, uidx* e) {
+	uint sh = BSORTBITS;
+	/* los rangos ocupan hasta 40 bits con LARGE_INDEX */
+	while (sh + BSORTBITS < 8*sizeof(uidx) && (c->n-1) >> (sh + BSORTBITS)) sh += BSORTBITS;
+	internal_bsort_rec(c,b,e,sh);
+	fix_index(c, b, e);
+//	check_invariant(c);
+}
+
+/*** Radix sort de indices que copia los pares (clave, indice) a qm ***/
+static inline void internal_copy_sort(bwt_ctx* c, uidx* b, uidx* e) {
+	uidx *x;
+	qpair *mu = c->qm;
+	KEY_VARS;
+	for(x=b; x!=e; ++x, ++mu) {
+		QP_SET(mu, KEY(*x), *x);
 	}
-#ifdef BWT_PSORT
-	psort_job_new(&bwt_ps, &(psort_job){qm, qm+mn});
-#else
-	internal_qsortM32(qm,qm+mn);
-#endif
+	radix_pairs(c->qm, c->qt, e-b);
+}
+
+/*** Solo ordena r[b, e) por clave, sin tocar p (menos de QSORTUB) ***/
+static void internal_sort_keys(bwt_ctx* c, uidx* b, uidx* e) {
+	uidx *x;
+	qpair *mu = c->qm;
+	internal_copy_sort(c, b, e);
+	for(x=b; x!=e; ++x, ++mu) *x = QP_IDX(mu);
+}
+
+/*** Ordena r[b, e) y deja en p el primer rango de cada grupo ***/
+static inline void internal_sort_M32(bwt_ctx* c, uidx* b, uidx* e) {
+	uidx *x, np, vl, nvl, d;
+	qpair *mu = c->qm;
+	uidx *p = c->p;
+	internal_copy_sort(c, b, e);
 	/* simpler fix_index ad-hoc */
-	mu = qm;
-	np = b-r;
-	vl = val_qsortM32(mu);
+	mu = c->qm;
+	np = b-c->r;
+	vl = QP_VAL(mu);
 	d = 0;
-	for(c=b; c!=e; ++c, ++mu) {
-		if (vl != (nvl = (val_qsortM32(mu)))) {
+	for(x=b; x!=e; ++x, ++mu) {
+		if (vl != (nvl = QP_VAL(mu))) {
 			vl = nvl;
-			d = (c-b);
+			d = (x-b);
 		}
-		p[*c = (*(mu) >> 32)] = np+d; /* Hi qsort value */
+		p[*x = QP_IDX(mu)] = np+d; /* Hi qsort value */
 	}
 }
 
 /*** Actualiza la estructura luego de ordenar un bucket ***/
-static inline void fix_index(uint *b, uint *e) {
-	uint pkm1, pk, np, i, d, m;
-	pkm1 = p[(*b+t)%n];
+static inline void fix_index(bwt_ctx* c, uidx *b, uidx *e) {
+	uidx pkm1, pk, np, i, d, m;
+	uidx *p = c->p;
+	KEY_VARS;
+	pkm1 = KEY(*b);
 	m = e-b; d = 0;
-	np = b-r; /* Id del bucket = posicion dentro del resultado */
+	np = b-c->r; /* Id del bucket = posicion dentro del resultado */
 	forn(i, m) {
-		if (((pk = p[(*b+t)%n]) != pkm1) && !(np <= pkm1 && pk < np+m)) {
+		if (((pk = KEY(*b)) != pkm1) && !(np <= pkm1 && pk < np+m)) {
 			pkm1 = pk;
 			d = i;
 		}
@@ -156,34 +184,60 @@ static inline void fix_index(uint *b, uint *e) {
 }
 
 /*** generic sort function ***/
-static inline int internal_sort(uint* b, uint* e) {
+static inline int internal_sort(bwt_ctx* c, uidx* b, uidx* e) {
 	if (e-b <= 1) {
 		return 1;
 	} else if (e-b < QSORTUB) {
-		internal_sort_M32(b,e);
+		internal_sort_M32(c,b,e);
 		return 0;
 	} else {
-		internal_bsort(b,e);
+		internal_bsort(c,b,e);
 		return 0;
 	}
 }
 
-/**
- * Función de BWT para usar 8*n RAM
- */
-void bwt(uchar *bwt, uint* pp, uint* rr, uchar* src, uint nn, uint* prim) {
+/*** Refina los buckets de r[b, e) y devuelve cuántos hay ***/
+static uidx refine(bwt_ctx* c, uidx b, uidx e) {
+	uidx i, j, nb = 0;
+	uidx *p = c->p, *r = c->r;
+	for(i = b, j = b+1; i < e; i = j++) {
+		/*calcular siguiente bucket*/
+		while(j < e && p[r[j]] == p[r[i]]) ++j;
+		internal_sort(c, r+i, r+j);
+		nb++;
+	}
+	return nb;
+}
+
+static void refine_chunk(void* arg, uint th) {
+	bwt_chunk* ch = (bwt_chunk*)arg;
+	ch->nb = refine(&ch->ctx[th], ch->b, ch->e);
+}
+
+static void bwt_ctx_init(bwt_ctx* c, uidx* p, uidx* r, uidx n) {
+	c->n = n; c->p = p; c->r = r;
+	c->t = 1; c->maxdepth = 0;
+	c->kb = p; c->ks = 1;
+	c->bc = (uidx*)pz_malloc(BSORTSIZE * sizeof(uidx));
+	c->qm = (qpair*)pz_malloc(QSORTUB*sizeof(qpair)); /* Memoria para el radix sort por copia */
+	c->qt = (qpair*)pz_malloc(QSORTUB*sizeof(qpair));
+}
+
+static void bwt_ctx_free(bwt_ctx* c) {
+	pz_free(c->bc);
+	pz_free(c->qm);
+	pz_free(c->qt);
+}
+
+/*** Inicializa p y r ordenando por los primeros dos caracteres ***/
+static void bwt_init_2(bwt_ctx* c, uchar* s, uidx* cc) {
 #define CONCAT(_F,_S) ((((ushort)_F) << 8) | ((ushort)_S))
-	uint i,j,lnb=0,nb = 1;
-	uchar *s = src?src:(uchar*)pp;
-	uint c[256];
-	bc = (uint*)pz_malloc(BSORTSIZE * sizeof(uint));
-	n = nn;
-	p = pp; r = rr;
-	t = 1;
-	memset(bc, 0, sizeof(uint)*BSORTSIZE);
-	memset(c, 0, sizeof(c));
-	forn(i,n-1) ++bc[CONCAT(s[i],s[i+1])], ++c[s[i]]; //calcular frecuencias (de 16 y de 8 bits en la misma pasada, para romper menos la cache)
-	++bc[CONCAT(s[n-1],s[0])]; ++c[s[n-1]];
+	uidx i, n = c->n;
+	uidx *p = c->p, *r = c->r, *bc = c->bc;
+	memset(bc, 0, sizeof(uidx)*BSORTSIZE);
+	memset(cc, 0, 256*sizeof(uidx));
+	forn(i,n-1) ++bc[CONCAT(s[i],s[i+1])], ++cc[s[i]]; //calcular frecuencias (de 16 y de 8 bits en la misma pasada, para romper menos la cache)
+	++bc[CONCAT(s[n-1],s[0])]; ++cc[s[n-1]];
 
 	/* Calcula la frecuencias acumuladas incluyendo hasta el índice dado */
 	forsn(i, 1, BSORTSIZE) { bc[i]+=bc[i-1]; }
@@ -196,75 +250,170 @@ void bwt(uchar *bwt, uint* pp, uint* rr, uchar* src, uint nn, uint* prim) {
 	//inicializar numero de posicion segun primer caracter-doble
 	p[n-1] = bc[CONCAT(s[n-1],s[0])];
 	dforn(i, n-1) p[i]=bc[CONCAT(s[i],s[i+1])];
+#undef CONCAT
+	c->t = 2;
+}
 
-	qm = (uint64*)pz_malloc(QSORTUB*sizeof(uint64)); /* Memoria para el qsort por copia */
+/*** Inicializa p y r ordenando por los primeros k caracteres: con el
+ * alfabeto renumerado en orden (b bits por simbolo), entran k = bits de
+ * uidx / b en una clave, que se arma en una pasada secuencial y se ordena
+ * con un counting sort por sus 16 bits altos y los sorters de cada ronda
+ * dentro de cada bucket. Con ~100 simbolos distintos son 4 caracteres en
+ * vez de 2, una ronda menos de duplicacion (9 y dos rondas con LARGE_INDEX).
+ * Devuelve FALSE (sin tocar p ni r) si no gana nada sobre bwt_init_2(). */
+static bool bwt_init_k(bwt_ctx* c, uchar* s, uidx* cc) {
+	uidx i, j, x, m, key, pk, mask, n = c->n;
+	uidx *p = c->p, *r = c->r, *bc = c->bc;
+	uint b, k, sh, sg = 0;
+	uchar code[256];
+	memset(cc, 0, 256*sizeof(uidx));
+	forn(i, n) ++cc[s[i]];
+	forn(i, 256) if (cc[i]) code[i] = sg++;
+	for(b = 1; (1U << b) < sg; ++b);
+	k = 8*sizeof(uidx) / b;
+	if (k <= 2 || n <= k) return FALSE;
+	mask = k*b == 8*sizeof(uidx) ? (uidx)-1 : ((uidx)1 << (k*b)) - 1;
+
+	/* clave de la rotacion i en p[i], corriendo la de i-1 */
+	key = 0;
+	forn(j, k) key = (key << b) | code[s[j]];
+	p[0] = key;
+	forsn(i, 1, n) {
+		key = ((key << b) & mask) | code[s[(i+k-1) % n]];
+		p[i] = key;
+	}
 
-#ifdef BWT_PSORT
-	psort_init(&bwt_ps, 4, psort_thread);
-#endif
+	/* por los 16 bits altos con un counting sort, como bwt_init_2() */
+	sh = k*b > BSORTBITS ? k*b - BSORTBITS : 0;
+	memset(bc, 0, sizeof(uidx)*BSORTSIZE);
+	forn(i, n) ++bc[p[i] >> sh];
+	forsn(i, 1, BSORTSIZE) bc[i] += bc[i-1];
+	dforn(i, n) r[--bc[p[i] >> sh]] = i;
+
+	/* y cada bucket por la clave entera, que deja en p su primer rango */
+	c->kb = p; c->ks = 0;
+	for(i = 0; i < n; i = j) {
+		pk = p[r[i]] >> sh;
+		for(j = i+1; j < n && p[r[j]] >> sh == pk; ++j);
+		if (j-i < QSORTUB) {
+			internal_sort_M32(c, r+i, r+j);
+			continue;
+		}
+		internal_bsort_rec(c, r+i, r+j, sh ? (sh-1) / BSORTBITS * BSORTBITS : 0);
+		pk = p[r[i]]; p[r[i]] = m = i;
+		forsn(x, i+1, j) {
+			if ((key = p[r[x]]) != pk) { pk = key; m = x; }
+			p[r[x]] = m;
+		}
+	}
+	c->t = k;
+	return TRUE;
+}
 
-	for(t = 2; t < n; t*=2) {
+/*** Rondas de duplicacion con varios threads.
+ * Cada ronda copia p corrido en t a k, asi las claves no cambian mientras
+ * otros threads actualizan los rangos de sus buckets, y reparte r en
+ * pedazos alineados a buckets. */
+static void bwt_rounds_parallel(bwt_ctx* c0, uint threads) {
+	psort ps;
+	bwt_ctx* ctx;
+	bwt_chunk* ch;
+	uidx *k, *p = c0->p, *r = c0->r, n = c0->n;
+	uidx i, j, b, step, nch, mch, lnb, nb = 1;
+	uint th;
+
+	k = (uidx*)pz_malloc(n * sizeof(uidx));
+	ctx = (bwt_ctx*)pz_malloc(threads * sizeof(bwt_ctx));
+	ctx[0] = *c0;
+	forsn(th, 1, threads) bwt_ctx_init(&ctx[th], p, r, n);
+	forn(th, threads) { ctx[th].kb = k; ctx[th].ks = 0; }
+	/* varios pedazos por thread para repartir mejor la carga */
+	mch = 8 * threads;
+	step = (n + mch - 1) / mch;
+	ch = (bwt_chunk*)pz_malloc((mch+1) * sizeof(bwt_chunk));
+
+	psort_init(&ps, threads);
+	for(; c0->t < n && bwt_deeper(c0, c0->t); c0->t*=2) {
+		memcpy(k, p + c0->t, (n - c0->t) * sizeof(uidx));
+		memcpy(k + n - c0->t, p, c0->t * sizeof(uidx));
+		/* p[r[j]] == j sii en j empieza un bucket */
+		nch = 0;
+		for(b = 0; b < n; b = j) {
+			j = b + step < n ? b + step : n;
+			while(j < n && p[r[j]] != j) ++j;
+			ch[nch].ctx = ctx; ch[nch].b = b; ch[nch].e = j;
+			psort_job_new(&ps, refine_chunk, &ch[nch++]);
+		}
+		psort_wait(&ps);
 		lnb = nb;
 		nb = 0;
-		for(i = 0, j = 1; i < n; i = j++) {
-			/*calcular siguiente bucket*/
-			while(j < n && p[r[j]] == p[r[i]]) ++j;
-			internal_sort(r+i, r+j);
-			nb++;
-		}
+		forn(i, nch) nb += ch[i].nb;
 		if (lnb == nb) break;
-		/*t*=2; printf ("---%d---\n",t);show(s,r); t/=2;*/
 	}
-#ifdef BWT_PSORT
-	psort_destroy(&bwt_ps);
-#endif
+	psort_destroy(&ps);
 
-	// Antes de hacer PERCHA p, me acuerdo dónde quedó la string original
-	if (prim) *prim = p[0];
+	forsn(th, 1, threads) bwt_ctx_free(&ctx[th]);
+	pz_free(ch);
+	pz_free(ctx);
+	pz_free(k);
+}
 
-	bwt_src_bc(bwt, p, r, src, n, c);
-	pz_free(bc);
-	pz_free(qm);
+/* Rango de la rotacion 0: su bucket empieza en p[0], pero si quedaron
+ * rotaciones empatadas puede no ser la primera */
+static uidx bwt_prim(uidx* p, uidx* r) {
+	uidx i = p[0];
+	while (r[i]) ++i;
+	return i;
 }
 
-void obwt(uchar *bwt, uint* pp, uint* rr, uchar* src, uint nn, uint* prim) {
-#define CONCAT(_F,_S) ((((ushort)_F) << 8) | ((ushort)_S))
-	uint i,j,k,lnb=0,nb = 1;
+/**
+ * Función de BWT para usar 8*n RAM
+ */
+void bwt(uchar *bwt, uidx* pp, uidx* rr, uchar* src, uidx nn, uidx* prim, const bwt_opts* o) {
+	uidx lnb=0,nb = 1;
 	uchar *s = src?src:(uchar*)pp;
-	uint c[256];
-	bc = (uint*)pz_malloc(BSORTSIZE * sizeof(uint));
-	int *l;
-	
-	n = nn;
-	p = pp; r = rr;
-	t = 1;
-	/* array to store the lengths of groups to skip */
-	l = (int*)pz_malloc(n * sizeof(int));
-	memset(bc, 0, sizeof(uint)*BSORTSIZE);
-	memset(c, 0, sizeof(c));
-	memset(l, 0, n * sizeof(int));
-	forn(i,n-1) ++bc[CONCAT(s[i],s[i+1])], ++c[s[i]]; //calcular frecuencias (de 16 y de 8 bits en la misma pasada, para romper menos la cache)
-	++bc[CONCAT(s[n-1],s[0])]; ++c[s[n-1]];
-
-	/* Calcula la frecuencias acumuladas incluyendo hasta el índice dado */
-	forsn(i, 1, BSORTSIZE) { bc[i]+=bc[i-1]; }
+	uidx c[256];
+	uint threads = o && o->threads ? o->threads : 1;
+	bwt_ctx ctx;
+	bwt_ctx_init(&ctx, pp, rr, nn);
+	ctx.maxdepth = o ? o->maxdepth : 0;
+	/* sin src, s esta en p y las claves lo pisarian */
+	if (!src || !bwt_init_k(&ctx, s, c)) bwt_init_2(&ctx, s, c);
+
+	if (threads > 1 && nn > BSORTSIZE) {
+		bwt_rounds_parallel(&ctx, threads);
+	} else for(; ctx.t < nn && bwt_deeper(&ctx, ctx.t); ctx.t*=2) {
+		ctx.ks = ctx.t;
+		lnb = nb;
+		nb = refine(&ctx, 0, nn);
+		if (lnb == nb) break;
+		/*t*=2; printf ("---%d---\n",t);show(&ctx,s); t/=2;*/
+	}
 
-	/* Inicializa el vector de indices */
-	forn(i, n-1) r[--bc[CONCAT(s[i],s[i+1])]] = i;
-	r[--bc[CONCAT(s[n-1],s[0])]] = n-1;
-	/* Esto deja las frecuencias acumuladas sin incluir el índice dado */
+	// Antes de hacer PERCHA p, me acuerdo dónde quedó la string original
+	if (prim) *prim = bwt_prim(pp, rr);
 
-	//inicializar numero de posicion segun primer caracter-doble
-	p[n-1] = bc[CONCAT(s[n-1],s[0])];
-	dforn(i, n-1) p[i]=bc[CONCAT(s[i],s[i+1])];
+	bwt_out_bc(bwt, pp, rr, src, nn, c);
+	bwt_ctx_free(&ctx);
+}
 
-	qm = (uint64*)pz_malloc(QSORTUB*sizeof(uint64)); /* Memoria para el qsort por copia */
+void obwt(uchar *bwt, uidx* pp, uidx* rr, uchar* src, uidx nn, uidx* prim, const bwt_opts* o) {
+	uidx i,j,k,lnb=0,nb = 1;
+	uchar *s = src?src:(uchar*)pp;
+	uidx c[256];
+	uidx *p = pp, *r = rr, n = nn;
+	sidx *l;
+	bwt_ctx ctx;
+	bwt_ctx_init(&ctx, pp, rr, nn);
+	ctx.maxdepth = o ? o->maxdepth : 0;
 
-#ifdef BWT_PSORT
-	psort_init(&bwt_ps, 4, psort_thread);
-#endif
+	/* array to store the lengths of groups to skip */
+	l = (sidx*)pz_malloc(n * sizeof(sidx));
+	memset(l, 0, n * sizeof(sidx));
+	bwt_init_2(&ctx, s, c);
 
-	for(t = 2; t < n; t*=2) {
+	for(; ctx.t < n && bwt_deeper(&ctx, ctx.t); ctx.t*=2) {
+		ctx.ks = ctx.t;
 		lnb = nb;
 		nb = 0;
 		for(i = 0, j = 1; i < n; i = j++) {
@@ -277,36 +426,32 @@ void obwt(uchar *bwt, uint* pp, uint* rr, uchar* src, uint nn, uint* prim) {
 			j = i + 1;
 			/*calcular siguiente bucket*/
 			while(j < n && p[r[j]] == p[r[i]]) ++j;
-			if (internal_sort(r+i, r+j) && i < n) l[i] = -1;
+			if (internal_sort(&ctx, r+i, r+j) && i < n) l[i] = -1;
 			nb++;
 		}
 		if (lnb == nb) break;
-		/*t*=2; printf ("---%d---\n",t);show(s,r); t/=2;*/
+		/*t*=2; printf ("---%d---\n",t);show(&ctx,s); t/=2;*/
 	}
-#ifdef BWT_PSORT
-	psort_destroy(&bwt_ps);
-#endif
 
 	// Antes de hacer PERCHA p, me acuerdo dónde quedó la string original
-	if (prim) *prim = p[0];
+	if (prim) *prim = bwt_prim(p, r);
 
-	bwt_src_bc(bwt, p, r, src, n, c);
+	bwt_out_bc(bwt, p, r, src, n, c);
 	pz_free(l);
-	pz_free(bc);
-	pz_free(qm);
+	bwt_ctx_free(&ctx);
 }
 
 
 /** Inversa de BWT **/
-void ibwt(uchar *src, uchar *dst, uint n, uint prim) {
-	uint i,j,sum;
-	uint *ind = (uint*)pz_malloc(n * sizeof(uint));
-	bc = (uint*)pz_malloc(256 * sizeof(uint));
-	memset(bc, 0, 256 * sizeof(uint));
+void ibwt(uchar *src, uchar *dst, uidx n, uidx prim) {
+	uidx i,j,sum;
+	uidx *ind = (uidx*)pz_malloc(n * sizeof(uidx));
+	uidx *bc = (uidx*)pz_malloc(256 * sizeof(uidx));
+	memset(bc, 0, 256 * sizeof(uidx));
 	forn(i, n) ind[i] = bc[src[i]]++;
 	sum = 0;
 	forn(i, 256){
-		register uint __t = bc[i];
+		register uidx __t = bc[i];
 		bc[i] = sum;
 		sum += __t;
 	}
@@ -319,8 +464,8 @@ void ibwt(uchar *src, uchar *dst, uint n, uint prim) {
 	pz_free(bc);
 }
 
-void bwt_src_bc(uchar *bwt, uint *p, uint *r, uchar *src, uint n, uint* bc) {
-	uint i, j;
+void bwt_src_bc(uchar *bwt, uidx *p, uidx *r, uchar *src, uidx n, uidx* bc) {
+	uidx i, j;
 	/* Regenera la entrada en src */
 	if (!src) src = ((uchar*)(p+n)) - n;
 	j = 0;
@@ -331,27 +476,39 @@ void bwt_src_bc(uchar *bwt, uint *p, uint *r, uchar *src, uint n, uint* bc) {
 	dforn(i, n) *(--bwt) = src[(r[i]+n-1)%n];
 }
 
-void bwt_rsrc_pbc(uchar *bwt, uint *p, uint *r, uchar* src, uint n, uint* bc) {
-	uint i;
+void bwt_out_bc(uchar *bwt, uidx *p, uidx *r, uchar *src, uidx n, uidx* bc) {
+	uidx i;
+	if (!src || (p && src < (uchar*)(p+n) && src+n > (uchar*)p)) {
+		bwt_src_bc(bwt, p, r, src, n, bc);
+		return;
+	}
+	if (!bwt) bwt = (uchar*)p;
+	bwt += n;
+	dforn(i, n) *(--bwt) = src[(r[i]+n-1)%n];
+}
+
+void bwt_rsrc_pbc(uchar *bwt, uidx *p, uidx *r, uchar* src, uidx n, uidx* bc) {
+	uidx i;
 	forn(i, n) r[p[i]] = i;
 	bwt_src_bc(bwt, p, r, src, n, bc);
 }
 
-void bwt_build_bc(uchar* src, uint n, uint* bc) {
-	uint i;
-	memset(bc, 0, 256 * sizeof(uint));
+void bwt_build_bc(uchar* src, uidx n, uidx* bc) {
+	uidx i;
+	memset(bc, 0, 256 * sizeof(uidx));
 	forn(i, n) bc[src[i]]++;
 }
 
-void bwt_spr(uchar *bwt, uint *p, uint *r, uchar *src, uint n, uint prim) {
-	uint i,j,sum;
+void bwt_spr(uchar *bwt, uidx *p, uidx *r, uchar *src, uidx n, uidx prim) {
+	uidx i,j,sum;
+	uidx *bc;
 	if (!bwt) bwt = (uchar*)p;
-	bc = (uint*)pz_malloc(256 * sizeof(uint));
-	memset(bc, 0, 256 * sizeof(uint));
+	bc = (uidx*)pz_malloc(256 * sizeof(uidx));
+	memset(bc, 0, 256 * sizeof(uidx));
 	forn(i, n) bc[bwt[i]]++;
 	sum = 0;
 	forn(i, 256){
-		register uint t = bc[i]; bc[i] = sum; sum += t;
+		register uidx t = bc[i]; bc[i] = sum; sum += t;
 	}
 	forn(i, n) { r[i] = bc[bwt[i]]++; }
 	// Dejo de usar src[]
@@ -370,10 +527,11 @@ void bwt_spr(uchar *bwt, uint *p, uint *r, uchar *src, uint n, uint prim) {
 }
 
 /*** DEBUG ***/
-void show(uchar* s, uint* r) {
-	int i,j;
+void show(bwt_ctx* c, uchar* s) {
+	uidx i,j;
+	uidx n = c->n, t = c->t, *p = c->p, *r = c->r;
 	forn(i,n) {
-		printf("%d (%d,%d)", r[i], p[r[i]], p[(r[i]+t)%n]);
+		printf(UIDX_FMT" ("UIDX_FMT","UIDX_FMT")", r[i], p[r[i]], p[(r[i]+t)%n]);
 		if (i) forn(j,t) {
 			char a=s[(r[i-1]+j)%n];
 			char b=s[(r[i]+j)%n];
@@ -18,9 +18,26 @@
  *  p[i] will be the rank of the rotation i (if not overlap with src or bwt)
  *
  * src and bwt could be both NULL. See bwt_src_bc() below for details.
+ *
+ * o son las opciones de esta llamada (NULL: un thread y el orden
+ * completo); no hay estado global, varias llamadas pueden correr a la vez.
+ */
+
+/** Opciones de bwt() y obwt().
+ * threads: cantidad de threads que usa bwt() para refinar los buckets de
+ *   cada ronda. Con más de uno usa n enteros más de memoria.
+ * maxdepth: dejan de duplicar en cuanto las rotaciones estan ordenadas por
+ *   sus primeros t >= maxdepth caracteres (0 las ordena del todo). Las que
+ *   comparten esos t quedan en cualquier orden, y p[x] es el primer rango
+ *   del grupo de x (ver maxl en lcp_plcp()). Si src o bwt se solapan con
+ *   p, p se pierde igual.
  */
+typedef struct {
+	uint threads;
+	uidx maxdepth;
+} bwt_opts;
 
-void bwt(uchar *bwt, uint* p, uint* r, uchar* src, uint n, uint* prim);
+void bwt(uchar *bwt, uidx* p, uidx* r, uchar* src, uidx n, uidx* prim, const bwt_opts* o);
 
 /** obwt() toma la cadena s de largo n (utilizando
  * los primeros n bytes de p si src==NULL, o src en caso contrario) y
@@ -40,13 +57,13 @@ void bwt(uchar *bwt, uint* p, uint* r, uchar* src, uint n, uint* prim);
  */
 
 
-void obwt(uchar *bwt, uint* p, uint* r, uchar* src, uint n, uint* prim);
+void obwt(uchar *bwt, uidx* p, uidx* r, uchar* src, uidx n, uidx* prim, const bwt_opts* o);
 
 /**
  * Inverse of bwt. src != dst.
- * Uses an internal array of uint of length n.
+ * Uses an internal array of uidx of length n.
  */
-void ibwt(uchar *src, uchar *dst, uint n, uint prim);
+void ibwt(uchar *src, uchar *dst, uidx n, uidx prim);
 
 /**
  * bwt to src-p-r vectors.
@@ -66,7 +83,7 @@ void ibwt(uchar *src, uchar *dst, uint n, uint prim);
  *  If src is NULL, point to the last n uchars of array p is asumed.
  * See bwt_src_bc().
  */
-void bwt_spr(uchar *bwt, uint *p, uint *r, uchar *src, uint n, uint prim);
+void bwt_spr(uchar *bwt, uidx *p, uidx *r, uchar *src, uidx n, uidx prim);
 
 /**
  * r & bc to bwt_out
@@ -87,14 +104,39 @@ void bwt_spr(uchar *bwt, uint *p, uint *r, uchar *src, uint n, uint prim);
  *  If src is NULL, point to the last n uchars of array p is asumed.
  *  If bwt and src ar both non-NULL, p could be safely NULL.
  */
-void bwt_src_bc(uchar *bwt, uint *p, uint *r, uchar *src, uint n, uint* bc);
+void bwt_src_bc(uchar *bwt, uidx *p, uidx *r, uchar *src, uidx n, uidx* bc);
+
+/**
+ * Same as bwt_src_bc(), but src is only rebuilt if it is NULL or overlaps
+ * p. Otherwise it is left untouched (it may be a read-only or mapped
+ * file) and only bwt is written. Used at the end of bwt() and sais_bwt().
+ */
+void bwt_out_bc(uchar *bwt, uidx *p, uidx *r, uchar *src, uidx n, uidx* bc);
 
 /**
  * r & p & bc to s & bwt_out
  *
  */
-void bwt_rsrc_pbc(uchar *bwt, uint *p, uint *r, uchar* src, uint n, uint* bc);
+void bwt_rsrc_pbc(uchar *bwt, uidx *p, uidx *r, uchar* src, uidx n, uidx* bc);
+
+void bwt_build_bc(uchar* src, uidx n, uidx* bc);
+
+/**
+ * Left context of the rotations, in rotation order: bw[i] is the character
+ * before rotation r[i] (the bwt output) and prim is the rank of rotation 0,
+ * the only one whose previous character is not part of the text.
+ * Reading bw instead of s[r[i]-1] keeps the left checks sequential.
+ * A sparse index (see sparse.h) sets lid instead: the left context is then
+ * a number in [0, nid), the name of the previous segment.
+ */
+typedef struct {
+	uchar* bw;
+	uidx prim;
+	uidx* lid;
+	uidx nid;
+} left_ctx;
 
-void bwt_build_bc(uchar* src, uint n, uint* bc);
+#define lctx_has(lc, i) ((i) != (lc)->prim)
+#define lctx_at(lc, i) ((lc)->lid ? (lc)->lid[i] : (uidx)(lc)->bw[i])
 
 #endif //__BWT_H__
@@ -3,6 +3,9 @@
 #include <assert.h>
 #include <errno.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "common.h"
 
 #include "macros.h"
@@ -53,6 +56,16 @@ void *_pz_malloc(size_t n, char *file, int line) {
 	return p;
 }
 
+void *_pz_realloc(void *ptr, size_t n, char *file, int line) {
+	void *p;
+	if (!(p = realloc(ptr, n))) {
+		fprintf(stderr, "%s:%d REALLOC of %lu bytes failed\n", file, line, (unsigned long)n);
+		fflush(stderr);
+		exit(1);
+	}
+	return p;
+}
+
 void _pz_free(void *ptr, char *file, int line) {
 #if _DEBUG_LOG_MALLOC
 	fprintf(stderr, "%s:%d log pz_free(%p)\n", file, line, ptr);
@@ -64,11 +77,11 @@ void _pz_free(void *ptr, char *file, int line) {
 /**
  * Lee un archivo string a un buffer contiguo alocado por esta función y lo devuelve.
  */
-uchar* loadStrFile(const char* filename, uint* n) {
+uchar* loadStrFile(const char* filename, uidx* n) {
 	return loadStrFileExtraSpace(filename, n, 0);
 }
 
-uchar* loadStrFileExtraSpace(const char* filename, uint* n, uint esp) {
+uchar* loadStrFileExtraSpace(const char* filename, uidx* n, uidx esp) {
 	uchar* res;
 	fprintf(stderr, "Loading file %s ", filename);
 	FILE* f = fopen(filename, "r");
@@ -86,7 +99,7 @@ uchar* loadStrFileExtraSpace(const char* filename, uint* n, uint esp) {
 /**
  * Writes a mem buffer to a new or existant file. Returns true if success.
  */
-bool saveStrFile(const char* fn, const void* buf, uint n) {
+bool saveStrFile(const char* fn, const void* buf, uidx n) {
 	bool res;
 	FILE* f = fopen(fn, "wb");
 	if (!f) return 0;
@@ -99,17 +112,17 @@ bool saveStrFile(const char* fn, const void* buf, uint n) {
 /**
  * Lee un archivo FILE* a un buffer contiguo alocado por esta función y lo devuelve.
  */
-uchar* loadFile(FILE* f, uint* n) {
+uchar* loadFile(FILE* f, uidx* n) {
 	return loadFileExtraSpace(f, n, 0);
 }
 
 /**
  * Lee un archivo FILE* a un buffer contiguo alocado por esta función y lo devuelve.
  */
-uchar* loadFileExtraSpace(FILE* f, uint* n, uint esp) {
+uchar* loadFileExtraSpace(FILE* f, uidx* n, uidx esp) {
 	uchar **mat = NULL, **tmp;
 	uchar *res;
-	uint r, i=0, m=0;
+	uidx r, i=0, m=0;
 	do {
 		new_chunck;
 		r = fread(mat[i-1], 1, CHUNK, f);
@@ -130,10 +143,55 @@ uchar* loadFileExtraSpace(FILE* f, uint* n, uint esp) {
 /**
  * Writes a mem buffer to a FILE*. Returns true if success.
  */
-bool saveFile(FILE* f, const void* buf, uint n) {
+bool saveFile(FILE* f, const void* buf, uidx n) {
 	return n == fwrite(buf, 1, n, f);
 }
 
+/**
+ * Mapea un archivo a memoria seguido de esp bytes escribibles.
+ * Reserva primero todo el rango anónimo y encima mapea el archivo
+ * (MAP_FIXED), así el final queda contiguo al contenido.
+ */
+uchar* mapStrFileExtraSpace(const char* filename, uidx* n, uidx esp, bool* mapped) {
+	struct stat st;
+	uchar* res;
+	size_t len;
+	int fd;
+	*mapped = FALSE;
+	fd = open(filename, O_RDONLY);
+	if (fd == -1 || fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || !st.st_size) {
+		if (fd != -1) close(fd);
+		return loadStrFileExtraSpace(filename, n, esp);
+	}
+	fprintf(stderr, "Mapping file %s ", filename);
+	len = st.st_size + esp;
+	res = (uchar*)mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (res == MAP_FAILED
+		|| mmap(res, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		fprintf(stderr, "[%s]\n", strerror(errno));
+		if (res != MAP_FAILED) munmap(res, len);
+		close(fd);
+		return loadStrFileExtraSpace(filename, n, esp);
+	}
+	close(fd);
+#ifdef MADV_SEQUENTIAL
+	madvise(res, st.st_size, MADV_SEQUENTIAL);
+#endif
+#ifdef MADV_HUGEPAGE
+	madvise(res, len, MADV_HUGEPAGE);
+#endif
+	if (n != NULL) *n = st.st_size;
+	*mapped = TRUE;
+	fprintf(stderr, "[OK]\n");
+	return res;
+}
+
+void unmapStrFile(uchar* buf, uidx n, uidx esp, bool mapped) {
+	if (!buf) return;
+	if (mapped) munmap(buf, n + esp);
+	else pz_free(buf);
+}
+
 /**
  * Returns TRUE if file "fn" exists
  */
@@ -145,7 +203,7 @@ bool fileexists(const char* fn) {
 /**
  * Returns the size of "fn" or -1 if error.
  */
-int filesize(const char* fn) {
+long long filesize(const char* fn) {
   struct stat buf;
   if (stat(fn, &buf) == -1) return -1;
   return buf.st_size;
@@ -158,10 +216,10 @@ int filesize(const char* fn) {
 /**
  * Lee un archivo por nombre, comprimido con gzip, a un buffer contiguo alocado por esta función y lo devuelve.
  */
-uchar* loadStrGzFile(const char* filename, uint* n) {
+uchar* loadStrGzFile(const char* filename, uidx* n) {
 	uchar **mat = NULL, **tmp;
 	uchar *res;
-	uint r=CHUNK, i=0, m=0;
+	uidx r=CHUNK, i=0, m=0;
 	fprintf(stderr, "Loading file %s ", filename);
 	gzFile f = gzopen(filename, "rb");
 	if (!f) {
@@ -191,7 +249,7 @@ uchar* loadStrGzFile(const char* filename, uint* n) {
 /**
  * Writes a mem buffer to a new or existant file and compress it with gzip. Returns true if success.
  */
-bool saveStrGzFile(const char* filename, const void* buf, uint n) {
+bool saveStrGzFile(const char* filename, const void* buf, uidx n) {
 	uint res;
 	gzFile f = gzopen(filename, "wb");
 	if (!f) return 0;
@@ -13,20 +13,30 @@ inline void endian_swap_64(uint64* x);
 
 void *_pz_malloc(size_t n, char *file, int line);
 void _pz_free(void *ptr, char *file, int line);
-
-uchar* loadStrFile(const char*, uint* n);
-uchar* loadStrFileExtraSpace(const char*, uint* n, uint esp);
-bool saveStrFile(const char* fn, const void* buf, uint n);
-uchar* loadFile(FILE* f, uint* n);
-uchar* loadFileExtraSpace(FILE*, uint* n, uint esp);
-bool saveFile(FILE* f, const void* buf, uint n);
+void *_pz_realloc(void *ptr, size_t n, char *file, int line);
+
+uchar* loadStrFile(const char*, uidx* n);
+uchar* loadStrFileExtraSpace(const char*, uidx* n, uidx esp);
+bool saveStrFile(const char* fn, const void* buf, uidx n);
+uchar* loadFile(FILE* f, uidx* n);
+uchar* loadFileExtraSpace(FILE*, uidx* n, uidx esp);
+bool saveFile(FILE* f, const void* buf, uidx n);
+
+/** Maps the file fn in memory, followed by esp writable bytes.
+ * The mapping is private: writes are not saved to the file and only copy
+ * the pages they touch. Falls back to loadStrFileExtraSpace() when the
+ * file can not be mapped; *mapped tells which one was used.
+ */
+uchar* mapStrFileExtraSpace(const char* fn, uidx* n, uidx esp, bool* mapped);
+/** Releases a buffer returned by mapStrFileExtraSpace() */
+void unmapStrFile(uchar* buf, uidx n, uidx esp, bool mapped);
 
 bool fileexists(const char* fn);
-int filesize(const char* fn);
+long long filesize(const char* fn);
 
 #ifdef GZIP
-uchar* loadStrGzFile(const char*, uint* n);
-bool saveStrGzFile(const char* filename, const void* buf, uint n);
+uchar* loadStrGzFile(const char*, uidx* n);
+bool saveStrGzFile(const char* filename, const void* buf, uidx n);
 #endif
 
 /** Command line "functions" **/
@@ -132,13 +132,19 @@
 #define HAVE__BOOL 1
 
 /* Define if you have the __builtin_clz function. */
-/* #undef HAVE___BUILTIN_CLZ */
+#ifdef __GNUC__
+#define HAVE___BUILTIN_CLZ 1
+#endif
 
 /* Define if you have the __builtin_clzl function. */
-/* #undef HAVE___BUILTIN_CLZL */
+#ifdef __GNUC__
+#define HAVE___BUILTIN_CLZL 1
+#endif
 
 /* Define if you have the __builtin_clzll function. */
-/* #undef HAVE___BUILTIN_CLZLL */
+#ifdef __GNUC__
+#define HAVE___BUILTIN_CLZLL 1
+#endif
 
 /* Define to 1 if `lstat' dereferences a symlink specified with a trailing
    slash. */
@@ -1,5 +1,9 @@
 #include "cop.h"
 #include "macros.h"
+#include "emem.h"
+
+#include <string.h>
+#include <ctype.h>
 
 /* Maximum Common Length  */
 
@@ -15,11 +19,11 @@
  */
 #define define_mcl(NAME, IS_IN_S, R) 	\
 /* TODO: in the case of own patterns it is possible to update the array in-place */ \
-void NAME(uint* r, uint* h, uint n, uint* m, uint sn){ \
+void NAME(pidx* r, lcp_array* h, uidx n, uidx* m, uidx sn){ \
 	/* indices */ \
-	uint i; \
+	uidx i; \
 	/* current maximum common characters */ \
-	uint cm = 0; \
+	uidx cm = 0; \
 	/* current index is in s */ \
 	bool cs = IS_IN_S(0); \
 	if (cs) m[R(0)] = 0; \
@@ -33,11 +37,11 @@ void NAME(uint* r, uint* h, uint n, uint* m, uint sn){ \
 		}	 \
 		/* ts */ \
 		if (!cs){  \
-			cm = h[i]; \
+			cm = lcpa_get(h, i); \
 			cs = TRUE; \
 		} \
 		/* ss */ \
-		else if (h[i] < cm) cm = h[i]; \
+		else if (lcpa_get(h, i) < cm) cm = lcpa_get(h, i); \
 		m[R(i+1)] = cm; \
 	} \
 	cs = IS_IN_S(n-1); \
@@ -51,67 +55,152 @@ void NAME(uint* r, uint* h, uint n, uint* m, uint sn){ \
 		}	 \
 		/* ts */ \
 		if (!cs){  \
-			cm = h[i]; \
+			cm = lcpa_get(h, i); \
 			cs = TRUE; \
 		} \
 		/* ss */ \
-		else if (h[i] < cm) cm = h[i]; \
+		else if (lcpa_get(h, i) < cm) cm = lcpa_get(h, i); \
 		if (cm > m[R(i)]) m[R(i)] = cm; \
 	} \
 }
 
 /* Define the two versions of mcl */
 
-#define is_in_s(i) 		(r[(i)] < sn)
-#define r_at(i)			(r[(i)])
+#define is_in_s(i) 		(pidx_get(r, i) < sn)
+#define r_at(i)			(pidx_get(r, i))
 define_mcl(mcl, is_in_s, r_at)
 #undef is_in_s
 #undef r_at
 
-#define is_in_s_reverse(i) 	(r[(i)] >= n - sn)
-#define r_at_reverse(i) 	(r[(i)] - n + sn)
+#define is_in_s_reverse(i) 	(pidx_get(r, i) >= n - sn)
+#define r_at_reverse(i) 	(pidx_get(r, i) - n + sn)
 define_mcl(mcl_reverse, is_in_s_reverse, r_at_reverse)
 #undef is_in_s_reverse
 #undef r_at_reverse
 
-void csu(uint* m, uint* mt, uint n){
-	uint i;
-	forn(i,n) if(mt[i] < m[i]) m[i] = mt[i];
+void mcl_ms(occ_index* oc, uchar* s, pidx* r, lcp_array* h, uidx sn, uchar* t, uidx tn, uidx* m){
+	uidx q, g, x, l, lp = 0, ls = 0, cm;
+	/* the real ends of s and t, before their sentinels, which may also
+	 * occur in them */
+	uidx se = sn-1, te = tn-1;
+	/* rank of each suffix of t among the suffixes of s */
+	uidx* rk = (uidx*)emem_malloc(tn * sizeof(uidx));
+	/* longest common prefix of the suffixes of t placed right before
+	 * (up) and right after (dn) each suffix of s */
+	uidx* up = (uidx*)emem_malloc((sn+1) * sizeof(uidx));
+	uidx* dn = (uidx*)emem_malloc((sn+1) * sizeof(uidx));
+	memset(up, 0, (sn+1) * sizeof(uidx));
+	memset(dn, 0, (sn+1) * sizeof(uidx));
+
+	/* from the empty suffix at the sentinel of t */
+	rk[te] = g = 0;
+	for(q = te; q-- > 0;) rk[q] = g = oc->c[t[q]] + occ_rank(oc, t[q], g);
+
+	/* The neighbours of t[q+1..] share at least one character less than
+	 * those of t[q..] */
+	forn(q, tn) {
+		g = rk[q];
+		if (g > 0) {
+			x = pidx_get(r, g-1);
+			l = lp ? lp-1 : 0;
+			while (q+l < te && x+l < se && t[q+l] == s[x+l]) l++;
+			if (l > dn[g]) dn[g] = l;
+			lp = l;
+		} else lp = 0;
+		if (g < sn) {
+			x = pidx_get(r, g);
+			l = ls ? ls-1 : 0;
+			while (q+l < te && x+l < se && t[q+l] == s[x+l]) l++;
+			if (l > up[g]) up[g] = l;
+			ls = l;
+		} else ls = 0;
+	}
+	emem_free(rk);
+
+	/* update downwards */
+	cm = 0;
+	forn(g, sn) {
+		if (g > 0 && lcpa_get(h, g-1) < cm) cm = lcpa_get(h, g-1);
+		if (up[g] > cm) cm = up[g];
+		up[g] = cm;
+	}
+	/* update upwards */
+	cm = 0;
+	dforn(g, sn) {
+		if (g+1 < sn && lcpa_get(h, g) < cm) cm = lcpa_get(h, g);
+		if (dn[g+1] > cm) cm = dn[g+1];
+		m[pidx_get(r, g)] = up[g] > cm ? up[g] : cm;
+	}
+	emem_free(dn);
+	emem_free(up);
+}
+
+void csu(pidx* m, uidx* mt, uidx n){
+	uidx i;
+	forn(i,n) if(mt[i] < pidx_get(m, i)) pidx_set(m, i, mt[i]);
 }
 
-void opu(uint* m, uint* mt, uint n){
-	uint i;
-	forn(i,n) if(mt[i] > m[i]) m[i] = mt[i];
+void opu(pidx* m, uidx* mt, uidx n){
+	uidx i;
+	forn(i,n) if(mt[i] > pidx_get(m, i)) pidx_set(m, i, mt[i]);
 }
 
 
-void own_filter_callback(uint l, uint i, uint n, void* fdata){
-	int j = ((filter_data*)fdata)->r[i];
-	if ( l > ((filter_data*)fdata)->filter[j])
+void own_filter_callback(uidx l, uidx i, uidx n, void* fdata){
+	pidx* f = ((filter_data*)fdata)->filter;
+	if ( l > (f ? pidx_get(f, pidx_get(((filter_data*)fdata)->r, i)) : 0))
 		((filter_data*)fdata)->callback(l, i, n, ((filter_data*)fdata)->data);
 }
 
-void common_substrings(uchar *s, uint n, uint* r, uint* m, uint *h, uint ml, output_callback* out, void* data){
+void repeat_filter_callback(uidx l, uidx i, uidx n, void* rdata){
+	repeat_filter_data* rf = (repeat_filter_data*)rdata;
+	uchar *t, *e;
+	uidx nl;
+	if (n < rf->minocc || (rf->maxocc && n > rf->maxocc)) return;
+	t = rf->s + pidx_get(rf->r, i);
+	e = t + l;
+	if (rf->noblank) {
+		while (t < e && (isblank(*t) || iscntrl(*t))) ++t;
+		if (t == e) return;
+		t = e - l;
+	}
+	if (rf->nonull) {
+		while (t < e && !*t) ++t;
+		if (t == e) return;
+		t = e - l;
+	}
+	/* stops counting once there are enough */
+	for (nl = 1; nl < rf->minlines && t < e-1; ++t) if (*t == '\n') ++nl;
+	if (nl < rf->minlines) return;
+	rf->callback(l, i, n, rf->data);
+}
+
+/* m at the position of the suffix r[i], and at the one before it */
+#define M_AT(i) pidx_get(m, pidx_get(r, i))
+#define M_BEFORE(i) pidx_get(m, pidx_get(r, i)-1)
+
+void common_substrings(uchar *s, uidx n, pidx* r, pidx* m, lcp_array *h, uidx ml, output_callback* out, void* data){
 
-	uint i;
+	uidx i, hi;
 	bool alive = TRUE;
 	forn(i, n-1){
 		// maximality to the left
-		if (alive && r[i] > 0 && m[r[i]-1] > m[r[i]]) alive = FALSE;
+		if (alive && pidx_get(r, i) > 0 && M_BEFORE(i) > M_AT(i)) alive = FALSE;
 		//printf("i %d, s[r[i]] %c, r[i] %d, alive %d, ml %d, h[i] %d, m[r[i]] %d\n", i, s[r[i]], r[i], alive, ml, h[i], m[r[i]]);
 		
-		if (h[i] >= m[r[i]]) {
-			if (m[r[i+1]] > m[r[i]]) alive = TRUE;
+		hi = lcpa_get(h, i);
+		if (hi >= M_AT(i)) {
+			if (M_AT(i+1) > M_AT(i)) alive = TRUE;
 		} else {
-			if (alive && (m[r[i]] >= ml)) {
+			if (alive && (M_AT(i) >= ml)) {
 				//printf("l %d i %d r[i] %d\n", m[r[i]], i, m[r[i]]);
-				out(m[r[i]], i, 1, data);
+				out(M_AT(i), i, 1, data);
 			}
-			alive = (m[r[i]] < m[r[i+1]] || h[i] < m[r[i+1]]);
+			alive = (M_AT(i) < M_AT(i+1) || hi < M_AT(i+1));
 		}
 	}
 	
-	if (alive && (r[i] > 0 && m[r[i]-1] > m[r[i]]) && (m[r[i]] >= ml)) 
-		out(m[r[i]], i, 1, data);
+	if (alive && (pidx_get(r, i) > 0 && M_BEFORE(i) > M_AT(i)) && (M_AT(i) >= ml)) 
+		out(M_AT(i), i, 1, data);
 }
 
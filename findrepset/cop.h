@@ -2,14 +2,17 @@
 #define __COP_H__
 
 #include "tipos.h"
+#include "pidx.h"
+#include "lcp.h"
+#include "occ.h"
 #include "output_callbacks.h"
 #include <stdio.h>
 
 
 typedef struct filter_data {
 void* data;
-uint* filter;
-uint* r;
+pidx* filter;
+pidx* r;
 output_callback* callback;
 } filter_data;
 
@@ -20,12 +23,44 @@ output_callback* callback;
  *
  * The prototype is the same as the other output_callbacks, using the structure
  * filter_data to store the filter array, the suffix array and the next callback
+ * A NULL filter (no rivals) only drops the repeats of length 0.
  *
  */
 
-void own_filter_callback(uint l, uint i, uint n, void* fdata);
+void own_filter_callback(uidx l, uidx i, uidx n, void* fdata);
 
-// void common_filter_callback(uint l, uint i, uint n, void* fdata);
+// void common_filter_callback(uidx l, uidx i, uidx n, void* fdata);
+
+typedef struct repeat_filter_data {
+uchar* s;
+pidx* r;
+uidx minocc, maxocc, minlines;
+bool noblank, nonull;
+output_callback* callback;
+void* data;
+} repeat_filter_data;
+
+/**
+ * Repeat Filter Callback
+ *
+ * An output_callback wrapper that drops, before they are formatted, the
+ * repeats with fewer than minocc or more than maxocc occurrences (0 for no
+ * limit), those made only of blanks and control characters (noblank) or
+ * only of null bytes (nonull), and those spanning fewer than minlines lines
+ * (a newline at the end does not start one more).
+ *
+ * The text of a repeat is read at its first occurrence in s, r being the
+ * suffix array the callback is given, with the text positions of the
+ * suffixes. Occurrences are counted as found, before any split at file
+ * boundaries; common_substrings() reports each repeat once (n = 1), so
+ * minocc and maxocc are not meant for it.
+ */
+
+void repeat_filter_callback(uidx l, uidx i, uidx n, void* rdata);
+
+/** Whether some repeat_filter_callback() filter is set */
+#define repeat_filter_any(rf) ((rf)->minocc > 1 || (rf)->maxocc || (rf)->minlines > 1 \
+	|| (rf)->noblank || (rf)->nonull)
 
 /**
  * Maximum Common Length
@@ -41,8 +76,30 @@ void own_filter_callback(uint l, uint i, uint n, void* fdata);
  * m: output - maximum common lengths for each position in s
  */
 
-void mcl(uint* r, uint* h, uint n, uint* m, uint sn);
-void mcl_reverse(uint* r, uint* h, uint n, uint* m, uint sn);
+void mcl(pidx* r, lcp_array* h, uidx n, uidx* m, uidx sn);
+void mcl_reverse(pidx* r, lcp_array* h, uidx n, uidx* m, uidx sn);
+
+/**
+ * Maximum Common Length from the index of s
+ *
+ * Same as mcl(), without sorting s and t together: each suffix of t is
+ * placed among the suffixes of s by backward search (oc), and its common
+ * prefix with its neighbours there is extended Kasai style. The time is
+ * linear in tn, plus one pass over r and h.
+ *
+ * Parameters:
+ * oc: C and Occ of the BWT of s
+ * r: suffix array of s
+ * h: lcp of r
+ * sn: length of s, r, h and m
+ * s: the string, ending with a 255 that does not occur before
+ * t: the other string, ending with a sentinel; it is not compared, and
+ *    254 or 255 inside t are plain characters
+ * tn: length of t
+ * m: output - maximum common lengths for each position in s
+ */
+
+void mcl_ms(occ_index* oc, uchar* s, pidx* r, lcp_array* h, uidx sn, uchar* t, uidx tn, uidx* m);
 
 /**
  * Common Substrings Update
@@ -55,7 +112,7 @@ void mcl_reverse(uint* r, uint* h, uint n, uint* m, uint sn);
  * n: length of the arrays
  */
 
-void csu(uint* m, uint* mt, uint n);
+void csu(pidx* m, uidx* mt, uidx n);
 
 /**
  * Own Patterns Update
@@ -68,7 +125,7 @@ void csu(uint* m, uint* mt, uint n);
  * n: length of the arrays
  */
 
-void opu(uint* m, uint* mt, uint n);
+void opu(pidx* m, uidx* mt, uidx n);
 
 /**
  * Common Substrings
@@ -85,7 +142,7 @@ void opu(uint* m, uint* mt, uint n);
  * m: mcl of s and the other strings
  */
 
-void common_substrings(uchar *s, uint n, uint* r, uint* m, uint *h,
-	uint ml, output_callback* out, void* data);
+void common_substrings(uchar *s, uidx n, pidx* r, pidx* m, lcp_array *h,
+	uidx ml, output_callback* out, void* data);
 
 #endif // __COP_H__
@@ -0,0 +1,158 @@
+#include "emem.h"
+#include "macros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+typedef struct {
+	void* p;
+	size_t n;
+	bool mapped;
+} emem_block;
+
+static uint64 em_budget = 0, em_used = 0, em_live = 0, em_peak = 0;
+static const char* em_dir = NULL;
+static emem_block* em_blocks = NULL;
+static uint em_nblocks = 0, em_szblocks = 0;
+static pthread_mutex_t em_mx = PTHREAD_MUTEX_INITIALIZER;
+
+void emem_init(uint64 budget, const char* dir) {
+	em_budget = budget;
+	em_dir = dir;
+}
+
+uint64 emem_budget(void) {
+	return em_budget;
+}
+
+int emem_tmpfile(void) {
+	char fn[4096];
+	const char* dir = em_dir ? em_dir : getenv("TMPDIR");
+	int fd;
+	snprintf(fn, sizeof(fn), "%s/findrepset.XXXXXX", dir ? dir : "/tmp");
+	if ((fd = mkstemp(fn)) == -1) {
+		fprintf(stderr, "emem: mkstemp %s [%s]\n", fn, strerror(errno));
+		return -1;
+	}
+	unlink(fn);
+	return fd;
+}
+
+static void* emem_map(size_t n) {
+	void* p;
+	int fd;
+	if ((fd = emem_tmpfile()) == -1) return NULL;
+	if (ftruncate(fd, n ? n : 1) == -1) {
+		fprintf(stderr, "emem: ftruncate %llu bytes [%s]\n", (uint64)n, strerror(errno));
+		close(fd);
+		return NULL;
+	}
+	p = mmap(NULL, n ? n : 1, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		fprintf(stderr, "emem: mmap %llu bytes [%s]\n", (uint64)n, strerror(errno));
+		return NULL;
+	}
+	return p;
+}
+
+static emem_block* emem_find(void* p) {
+	uint i;
+	forn(i, em_nblocks) if (em_blocks[i].p == p) return &em_blocks[i];
+	return NULL;
+}
+
+void* emem_malloc(size_t n) {
+	emem_block* b;
+	void* p;
+	pthread_mutex_lock(&em_mx);
+	if (em_nblocks == em_szblocks) {
+		em_szblocks = em_szblocks ? 2 * em_szblocks : 16;
+		em_blocks = (emem_block*)pz_realloc(em_blocks, em_szblocks * sizeof(emem_block));
+	}
+	b = &em_blocks[em_nblocks];
+	b->n = n;
+	b->mapped = em_budget && em_used + n > em_budget;
+	b->p = b->mapped ? emem_map(n) : pz_malloc(n);
+	if (!(p = b->p)) {
+		fprintf(stderr, "emem: no room for %llu bytes\n", (uint64)n);
+		exit(1);
+	}
+	if (!b->mapped) em_used += n;
+	if ((em_live += n) > em_peak) em_peak = em_live;
+	em_nblocks++;
+	pthread_mutex_unlock(&em_mx);
+	return p;
+}
+
+bool emem_mapped(void* p) {
+	emem_block* b;
+	bool m;
+	pthread_mutex_lock(&em_mx);
+	m = (b = emem_find(p)) && b->mapped;
+	pthread_mutex_unlock(&em_mx);
+	return m;
+}
+
+void emem_free(void* p) {
+	emem_block* b;
+	if (!p) return;
+	pthread_mutex_lock(&em_mx);
+	if (!(b = emem_find(p))) pz_free(p);
+	else {
+		if (b->mapped) munmap(b->p, b->n ? b->n : 1);
+		else { pz_free(b->p); em_used -= b->n; }
+		em_live -= b->n;
+		*b = em_blocks[--em_nblocks];
+	}
+	pthread_mutex_unlock(&em_mx);
+}
+
+void* emem_shrink(void* p, size_t n) {
+	emem_block* b;
+	void* q;
+	pthread_mutex_lock(&em_mx);
+	/* a failed shrink keeps the block as it was */
+	if (!(b = emem_find(p))) { if (!(q = realloc(p, n ? n : 1))) q = p; }
+	else if (b->mapped || n >= b->n || !(q = realloc(p, n ? n : 1))) q = p;
+	else {
+		em_used -= b->n - n;
+		em_live -= b->n - n;
+		b->p = q; b->n = n;
+	}
+	pthread_mutex_unlock(&em_mx);
+	return q;
+}
+
+uint64 emem_peak(void) {
+	uint64 pk;
+	pthread_mutex_lock(&em_mx);
+	pk = em_peak;
+	em_peak = em_live;
+	pthread_mutex_unlock(&em_mx);
+	return pk;
+}
+
+bool emem_parse_size(const char* s, uint64* size) {
+	char* e;
+	uint64 v;
+	uint sh = 0;
+	if (*s < '0' || *s > '9') return FALSE;
+	errno = 0;
+	v = strtoull(s, &e, 10);
+	if (errno) return FALSE;
+	switch (*e) {
+		case 't': case 'T': sh = 40; ++e; break;
+		case 'g': case 'G': sh = 30; ++e; break;
+		case 'm': case 'M': sh = 20; ++e; break;
+		case 'k': case 'K': sh = 10; ++e; break;
+	}
+	if (*e || (sh && v > ((uint64)-1) >> sh)) return FALSE;
+	*size = v << sh;
+	return TRUE;
+}
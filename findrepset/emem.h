@@ -0,0 +1,56 @@
+#ifndef __EMEM_H__
+#define __EMEM_H__
+
+#include <stddef.h>
+
+#include "tipos.h"
+
+/** Allocator for the big arrays (suffix array, LCP, ...) under a memory
+ * budget.
+ *
+ * While the sum of the live emem blocks fits in the budget they come
+ * from the heap. Past it, each new block is backed by an unlinked
+ * temporary file mapped in memory, so the kernel pages it out to disk
+ * instead of failing. Under a budget the suffix array is sorted with
+ * external sorts (see esa.h) and the LCP in blocks (see
+ * lcp_plcp_blocks()), both reading and writing the arrays in sequence,
+ * and mmrs scans them in order, so those arrays can be several times the
+ * RAM. The text is still read at random, and so are the arrays of mrs
+ * (-nm) and of the rivals, which thrash if mapped much past the free
+ * RAM. Without a budget (0, the default) they all come
+ * from the heap. Either way the live bytes are counted (see emem_peak()).
+ * emem_init() must be called before any other thread uses it.
+ */
+
+/** Sets the budget in bytes (0 = unlimited) and the directory for the
+ * temporary files (NULL uses $TMPDIR or /tmp) */
+void emem_init(uint64 budget, const char* dir);
+
+uint64 emem_budget(void);
+
+/** Exits with a message if the block can be neither allocated nor mapped */
+void* emem_malloc(size_t n);
+void emem_free(void* p);
+
+/** Whether the block p is backed by a temporary file */
+bool emem_mapped(void* p);
+
+/** Opens an unlinked temporary file in the directory of the mapped blocks,
+ * for data written and read back in sequence (see esa.h). Returns its
+ * descriptor, or -1 after a message if it cannot be created. */
+int emem_tmpfile(void);
+
+/** Shrinks the block p to n bytes. Mapped blocks keep their address. */
+void* emem_shrink(void* p, size_t n);
+
+/** Peak of the bytes in live blocks (in RAM or mapped) since the last
+ * call, or since the start; the next peak starts from the bytes live now.
+ * Allows measuring each phase of a run. */
+uint64 emem_peak(void);
+
+/** Parses sizes like "512M" or "4G" (K, M, G, T suffixes) into size.
+ * Returns FALSE, leaving size alone, if s is not a number with an
+ * optional suffix or does not fit in 64 bits. */
+bool emem_parse_size(const char* s, uint64* size);
+
+#endif //__EMEM_H__
@@ -0,0 +1,242 @@
+#include "esa.h"
+#include "sais.h"
+#include "radix.h"
+#include "emem.h"
+#include "macros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+/* Smallest run, so a tiny budget still merges a bounded number of runs */
+#define ESA_MINRUN (1 << 12)
+
+/* Fewest records read at once from a run while merging */
+#define ESA_MINBUF 64
+
+/* Characters packed in the first names */
+#define ESA_PACK sizeof(uidx)
+
+typedef struct {
+	uidx a, b, c;
+} esa_rec;
+
+/* Sorts records by (a, b), or by a alone, equal keys in the order they
+ * were put. Runs of sz records are sorted in memory and appended to a
+ * temporary file, and merged while reading. */
+typedef struct {
+	esa_rec *mem;       /* 2 sz records: buf and tmp, or the merge buffers */
+	esa_rec *buf, *tmp;
+	qpair *qa, *qt;
+	uidx n, sz, at;     /* records in buf, its size, next one to read */
+	bool two;
+	int fd;             /* the runs, -1 while they all fit in buf */
+	uint64* ro;         /* run k is [ro[k], ro[k+1]) in the file, in records */
+	uint nr, szr;
+	/* merge */
+	uidx per;           /* records of each run buffer */
+	uidx *rn, *rp;      /* records in the buffer of each run, next one */
+	uint64* rf;         /* next record of each run in the file */
+	uint *hp, hn;       /* heap of the runs with records left */
+} esa_sorter;
+
+static void esa_io(int fd, void* p, size_t n, uint64 off, bool wr) {
+	ssize_t k;
+	while (n) {
+		k = wr ? pwrite(fd, p, n, off) : pread(fd, p, n, off);
+		if (k <= 0) {
+			fprintf(stderr, "esa: %s %llu bytes of a run failed [%s]\n", wr ? "writing" : "reading",
+				(uint64)n, k ? strerror(errno) : "end of file");
+			exit(1);
+		}
+		p = (char*)p + k; n -= k; off += k;
+	}
+}
+
+static void esa_sort_init(esa_sorter* es, uidx sz, bool two) {
+	memset(es, 0, sizeof(esa_sorter));
+	es->sz = sz;
+	es->two = two;
+	es->fd = -1;
+	es->mem = (esa_rec*)pz_malloc(2 * sz * sizeof(esa_rec));
+	es->buf = es->mem; es->tmp = es->mem + sz;
+	es->qa = (qpair*)pz_malloc(sz * sizeof(qpair));
+	es->qt = (qpair*)pz_malloc(sz * sizeof(qpair));
+}
+
+static void esa_sort_free(esa_sorter* es) {
+	if (es->fd != -1) close(es->fd);
+	pz_free(es->mem);
+	if (es->qa) pz_free(es->qa);
+	if (es->qt) pz_free(es->qt);
+	if (es->ro) pz_free(es->ro);
+	if (es->rn) { pz_free(es->rn); pz_free(es->rp); pz_free(es->rf); pz_free(es->hp); }
+}
+
+/* Sorts buf, by b and then stably by a */
+static void esa_sort_run(esa_sorter* es) {
+	esa_rec* x;
+	uidx j;
+	if (es->two) {
+		forn(j, es->n) QP_SET(&es->qa[j], es->buf[j].b, j);
+		radix_pairs(es->qa, es->qt, es->n);
+		forn(j, es->n) es->tmp[j] = es->buf[QP_IDX(&es->qa[j])];
+		x = es->buf; es->buf = es->tmp; es->tmp = x;
+	}
+	forn(j, es->n) QP_SET(&es->qa[j], es->buf[j].a, j);
+	radix_pairs(es->qa, es->qt, es->n);
+	forn(j, es->n) es->tmp[j] = es->buf[QP_IDX(&es->qa[j])];
+	x = es->buf; es->buf = es->tmp; es->tmp = x;
+}
+
+/* Sorts buf and appends it to the file as a new run */
+static void esa_sort_spill(esa_sorter* es) {
+	if (es->fd == -1 && (es->fd = emem_tmpfile()) == -1) exit(1);
+	if (es->nr + 2 > es->szr) {
+		es->szr = es->szr ? 2 * es->szr : 64;
+		es->ro = (uint64*)pz_realloc(es->ro, es->szr * sizeof(uint64));
+		if (!es->nr) es->ro[0] = 0;
+	}
+	esa_sort_run(es);
+	esa_io(es->fd, es->buf, es->n * sizeof(esa_rec), es->ro[es->nr] * sizeof(esa_rec), TRUE);
+	es->ro[es->nr+1] = es->ro[es->nr] + es->n;
+	es->nr++;
+	es->n = 0;
+}
+
+static void esa_sort_put(esa_sorter* es, uidx a, uidx b, uidx c) {
+	esa_rec* x;
+	if (es->n == es->sz) esa_sort_spill(es);
+	x = &es->buf[es->n++];
+	x->a = a; x->b = b; x->c = c;
+}
+
+/* Refills the buffer of the run k if it is empty; FALSE if the run is over */
+static bool esa_sort_fill(esa_sorter* es, uint k) {
+	uint64 left = es->ro[k+1] - es->rf[k];
+	if (es->rp[k] < es->rn[k]) return TRUE;
+	if (!left) return FALSE;
+	es->rn[k] = left < es->per ? left : es->per;
+	es->rp[k] = 0;
+	esa_io(es->fd, es->mem + k * es->per, es->rn[k] * sizeof(esa_rec), es->rf[k] * sizeof(esa_rec), FALSE);
+	es->rf[k] += es->rn[k];
+	return TRUE;
+}
+
+/* The head of the run j goes before the one of k; ties by run, as put */
+static bool esa_sort_less(esa_sorter* es, uint j, uint k) {
+	esa_rec *x = es->mem + j * es->per + es->rp[j], *y = es->mem + k * es->per + es->rp[k];
+	if (x->a != y->a) return x->a < y->a;
+	if (es->two && x->b != y->b) return x->b < y->b;
+	return j < k;
+}
+
+static void esa_sort_down(esa_sorter* es, uint i) {
+	uint c, x;
+	while ((c = 2*i + 1) < es->hn) {
+		if (c+1 < es->hn && esa_sort_less(es, es->hp[c+1], es->hp[c])) ++c;
+		if (!esa_sort_less(es, es->hp[c], es->hp[i])) break;
+		x = es->hp[c]; es->hp[c] = es->hp[i]; es->hp[i] = x;
+		i = c;
+	}
+}
+
+/* Ends the puts; esa_sort_next() then gives the records in order */
+static void esa_sort_start(esa_sorter* es) {
+	uint k;
+	if (es->fd == -1) {
+		esa_sort_run(es);
+		es->at = 0;
+		return;
+	}
+	if (es->n) esa_sort_spill(es);
+	/* the buffers of the runs take the place of buf and tmp */
+	es->per = 2 * es->sz / es->nr;
+	if (es->per < ESA_MINBUF) {
+		pz_free(es->mem);
+		es->per = ESA_MINBUF;
+		es->mem = (esa_rec*)pz_malloc(es->nr * es->per * sizeof(esa_rec));
+	}
+	es->rn = (uidx*)pz_malloc(es->nr * sizeof(uidx));
+	es->rp = (uidx*)pz_malloc(es->nr * sizeof(uidx));
+	es->rf = (uint64*)pz_malloc(es->nr * sizeof(uint64));
+	es->hp = (uint*)pz_malloc(es->nr * sizeof(uint));
+	es->hn = 0;
+	forn(k, es->nr) {
+		es->rn[k] = es->rp[k] = 0;
+		es->rf[k] = es->ro[k];
+		if (esa_sort_fill(es, k)) es->hp[es->hn++] = k;
+	}
+	dforn(k, es->hn / 2) esa_sort_down(es, k);
+}
+
+static bool esa_sort_next(esa_sorter* es, esa_rec* x) {
+	uint k;
+	if (es->fd == -1) {
+		if (es->at == es->n) return FALSE;
+		*x = es->buf[es->at++];
+		return TRUE;
+	}
+	if (!es->hn) return FALSE;
+	k = es->hp[0];
+	*x = es->mem[k * es->per + es->rp[k]++];
+	if (!esa_sort_fill(es, k)) es->hp[0] = es->hp[--es->hn];
+	esa_sort_down(es, 0);
+	return TRUE;
+}
+
+void esa_bwt(uchar *bw, uidx* p, uidx* r, uchar* src, uidx n, uidx* prim, const bwt_opts* o) {
+	esa_sorter es, en;
+	esa_rec x;
+	uidx i, k, g, t, a = 0, b = 0, nm = 0, sz, c[256], *q = p;
+	uidx maxdepth = o ? o->maxdepth : 0;
+	bool last;
+	if (!src || (!emem_mapped(p) && !emem_mapped(r))) {
+		sais_bwt(bw, p, r, src, n, prim, o);
+		return;
+	}
+	if (!n) return;
+	/* the names need n entries even if the caller does not want p */
+	if (!q) q = (uidx*)emem_malloc(n * sizeof(uidx));
+	sz = emem_budget() / (4 * (2 * sizeof(esa_rec) + 2 * sizeof(qpair)));
+	if (sz < ESA_MINRUN) sz = ESA_MINRUN;
+
+	/* the first names are the first ESA_PACK characters, big-endian */
+	esa_sort_init(&es, sz, FALSE);
+	forn(i, ESA_PACK) a = a << 8 | src[i % n];
+	forn(i, n) {
+		esa_sort_put(&es, a, 0, i);
+		a = a << 8 | src[(i + ESA_PACK) % n];
+	}
+	for(t = ESA_PACK; ; t *= 2) {
+		/* r in order, and each rotation named by the first rank of its
+		 * group */
+		esa_sort_start(&es);
+		esa_sort_init(&en, sz, FALSE);
+		for(k = g = 0; esa_sort_next(&es, &x); ++k) {
+			if (!k || x.a != a || x.b != b) { nm = k; ++g; a = x.a; b = x.b; }
+			r[k] = x.c;
+			if (!x.c && prim) *prim = k;
+			esa_sort_put(&en, x.c, 0, nm);
+		}
+		esa_sort_free(&es);
+		last = g == n || t >= n || (maxdepth && t >= maxdepth);
+		/* the names back in text order, in p; without bw the BWT goes
+		 * over p at the end */
+		if (!last || bw) {
+			esa_sort_start(&en);
+			while (esa_sort_next(&en, &x)) q[x.a] = x.c;
+		}
+		esa_sort_free(&en);
+		if (last) break;
+		/* the pairs of names of the rotations i and i+t */
+		esa_sort_init(&es, sz, TRUE);
+		forn(i, n) esa_sort_put(&es, q[i], q[(i + t) % n], i);
+	}
+	if (q != p) emem_free(q);
+	if (!bw && !p) return;
+	bwt_build_bc(src, n, c);
+	bwt_out_bc(bw, p, r, src, n, c);
+}
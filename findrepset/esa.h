@@ -0,0 +1,28 @@
+#ifndef __ESA_H__
+#define __ESA_H__
+
+#include "tipos.h"
+#include "bwt.h"
+
+/** esa_bwt() is a drop-in replacement of bwt() (same parameters and
+ * output, see bwt.h) for a p and r that do not fit in RAM and are mapped
+ * to files by emem.h.
+ *
+ * It sorts the rotations by prefix doubling with external sorts, after
+ * Dementiev, Kärkkäinen, Mehnert & Sanders (2008): the first names pack
+ * the first characters of each rotation, and each round sorts the
+ * triples (name[i], name[i+t], i) in runs that fit in the memory budget,
+ * merges the runs back from a temporary file, names each rotation by the
+ * first rank of its group and sorts the names back in text order. p, r
+ * and the runs are only read and written in sequence. The rounds stop
+ * once the names are all distinct, or at o->maxdepth characters (see
+ * bwt_opts); o->threads is not used.
+ *
+ * src must be given and stay in RAM: the BWT is read from it at random.
+ * The two sorts alive at a time take up to half the budget on top of the
+ * arrays. p may be NULL if bw is NULL (see sais_bwt()). If neither p nor
+ * r is mapped, or src is NULL, it calls sais_bwt() instead.
+ */
+void esa_bwt(uchar *bw, uidx* p, uidx* r, uchar* src, uidx n, uidx* prim, const bwt_opts* o);
+
+#endif //__ESA_H__
@@ -4,6 +4,8 @@
 #include <errno.h>
 
 #include "bwt.h"
+#include "sais.h"
+#include "esa.h"
 #include "lcp.h"
 #include "cop.h"
 #include "tipos.h"
@@ -13,42 +15,419 @@
 #include "output_callbacks.h"
 #include "mrs.h"
 #include "tiempos.h"
+#include "emem.h"
+#include "idxfile.h"
+#include "occ.h"
+#include "psort.h"
+#include "sparse.h"
+#include "fsep.h"
+#include "tok.h"
 
 #define TIME_RUN_INIT tiempo __t1,__t2;
 #define TIME_RUN(var,op) { getTickTime(&__t1); { op; } getTickTime(&__t2); var = getTimeDiff(__t1, __t2); }
 #define TIME_RUN_AC(var,op) { getTickTime(&__t1); { op; } getTickTime(&__t2); var += getTimeDiff(__t1, __t2); }
 
+/* Size of each of the two output buffers */
+#define OW_BUFFER (4 << 20)
 
-void show_bwt_lcp(uint n, uchar* src, uint* r, uint* h) {
-	int i, j;
+
+void show_bwt_lcp(uidx n, uchar* src, uidx* r, uidx* h) {
+	uidx i, j;
 	printf("\n");
 	printf(" i  r[] lcp \n");
 	forn(i, n) {
-		printf("%3d %3d %3d ", i, r[i], h[i]);
+		printf("%3llu %3llu %3llu ", (uint64)i, (uint64)r[i], (uint64)h[i]);
 		forn(j, n) printf("%c", src[(r[i]+j)%n]);
 		printf("\n");
 	}
 }
 
+/* LCP of the rotations r of s, plain or compressed, capped at maxl if not 0
+ * (see lcp_plcp()). r and p are packed; p is destroyed, or with inplace
+ * (and compressed) turned into the LCP and freed (see
+ * lcpa_from_plcp_inplace()).
+ * Under a memory budget it is built by blocks of a quarter of it. */
+void build_lcp(lcp_array* la, uidx n, uchar* s, pidx* r, pidx* p, uint compressed, bool inplace,
+	uint threads, uidx maxl) {
+	uidx* h;
+	uidx blk = emem_budget() / (4 * sizeof(uidx));
+	if (blk < (1 << 16)) blk = 1 << 16;
+	if (compressed) {
+		if (emem_budget()) lcp_plcp_blocks(n, s, r, p, blk, maxl);
+		else lcp_plcp(n, s, r, p, threads, maxl);
+		if (inplace) lcpa_from_plcp_inplace(la, n, r, p);
+		else lcpa_from_plcp(la, n, r, p);
+	} else {
+		h = (uidx*)emem_malloc(n*sizeof(uidx));
+		if (emem_budget()) lcp_phi_blocks(n, s, r, p, h, blk, maxl);
+		else lcp_phi(n, s, r, p, h, threads, maxl);
+		lcpa_plain(la, h, n);
+	}
+}
+
+typedef void sa_builder(uchar*, uidx*, uidx*, uchar*, uidx, uidx*, const bwt_opts*);
+
+/* --low-mem: the peak of the phase just ended, the text included */
+static void mem_phase(const char* name, uidx sn) {
+	uint64 b = emem_peak() + sn;
+	fprintf(stderr, "%s peak: %llu bytes (%.2f n)\n", name, b, (double)b / sn);
+}
+
+/* Suffix array, LCP and BWT of s, mapped from the index file idxname if it
+ * matches s, or built (and saved there). With maxl, the suffixes are only
+ * sorted by their first maxl characters and the LCP is capped at maxl (not
+ * to be saved). Returns n entries of scratch if keep_p, NULL otherwise.
+ * With low (--low-mem, compressed LCP and no keep_p), the BWT is taken
+ * from s after the LCP, once p is gone, and each phase shows its peak. */
+static uidx* base_index(uchar* s, uidx sn, const char* idxname, idxfile* ix, pidx** pr,
+	lcp_array* h, left_ctx* lc, bool keep_p, bool low, sa_builder* sa_build, uint cl,
+	uint threads, uidx maxl, double* t_sarr, double* t_lcp) {
+	TIME_RUN_INIT
+	uidx *p, *r, i;
+	pidx* pp;
+	uint64 sum = 0;
+	bwt_opts bo;
+	memset(ix, 0, sizeof(idxfile));
+	memset(lc, 0, sizeof(left_ctx));
+	if (idxname) sum = idxf_checksum(s, sn);
+	if (idxname && idxf_open(ix, idxname, sn, sum)) {
+		*pr = ix->r;
+		*h = ix->h;
+		*lc = ix->lc;
+		return keep_p? (uidx*)emem_malloc(sn*sizeof(uidx)): NULL;
+	}
+	/* with low, SA-IS only needs r: p comes after it, packed */
+	p = low ? NULL : (uidx*)emem_malloc(sn*sizeof(uidx));
+	r = (uidx*)emem_malloc(sn*sizeof(uidx));
+	if (!low) lc->bw = (uchar*)emem_malloc(sn*sizeof(uchar));
+
+	bo.threads = threads; bo.maxdepth = maxl;
+	TIME_RUN_AC(*t_sarr,sa_build(lc->bw, p, r, s, sn, &lc->prim, &bo))
+	*pr = pidx_pack(r, sn);
+	if (low) {
+		mem_phase("Suffix array", sn);
+		pp = pidx_malloc(sn);
+		/* maxl takes the inverse of r */
+		if (maxl) forn(i, sn) pidx_set(pp, pidx_get(*pr, i), i);
+		TIME_RUN_AC(*t_lcp,build_lcp(h, sn, s, *pr, pp, cl, TRUE, threads, maxl))
+		lc->bw = (uchar*)emem_malloc(sn*sizeof(uchar));
+		forn(i, sn) lc->bw[i] = s[(pidx_get(*pr, i) + sn-1) % sn];
+		mem_phase("LCP", sn);
+	} else {
+		pp = pidx_pack(p, sn);
+		TIME_RUN_AC(*t_lcp,build_lcp(h, sn, s, *pr, pp, cl, FALSE, threads, maxl))
+		emem_free(pp);
+	}
+	if (idxname) idxf_save(idxname, sn, sum, *pr, h, lc);
+	return keep_p? (uidx*)emem_malloc(sn*sizeof(uidx)): NULL;
+}
+
+/* LCP of the m suffixes r from their PLCP p (both packed), plain or
+ * compressed, capped at maxl if not 0 */
+static void plcp_lcp(lcp_array* h, uidx m, pidx* r, pidx* p, uint cl, uidx maxl) {
+	uidx i, *hh;
+	if (maxl) forn(i, m) if (pidx_get(p, i) > maxl) pidx_set(p, i, maxl);
+	if (cl) {
+		lcpa_from_plcp(h, m, r, p);
+	} else {
+		hh = (uidx*)emem_malloc(m*sizeof(uidx));
+		forn(i, m) hh[i] = i+1 < m ? pidx_get(p, pidx_get(r, i+1)) : 0;
+		lcpa_plain(h, hh, m);
+	}
+}
+
+/* Sparse suffix array, LCP and left context of s over the boundaries read
+ * from bname (see sparse.h). Returns the number of suffixes, 0 on error. */
+static uidx sparse_index(uchar* s, uidx sn, const char* bname, pidx** pr, lcp_array* h,
+	left_ctx* lc, uint cl, uidx maxl, double* t_sarr, double* t_lcp) {
+	TIME_RUN_INIT
+	uidx *b, *p, *r;
+	uidx i, m;
+	pidx* pp;
+	if (!(b = sparse_load(bname, sn, &m))) return 0;
+	p = (uidx*)emem_malloc(m*sizeof(uidx));
+	r = (uidx*)emem_malloc(m*sizeof(uidx));
+	TIME_RUN_AC(*t_sarr,sparse_sa(s, sn, b, m, r, p, lc))
+	*pr = pidx_pack(r, m);
+	pp = pidx_pack(p, m);
+	TIME_RUN_AC(*t_lcp,plcp_lcp(h, m, *pr, pp, cl, maxl))
+	emem_free(pp);
+	forn(i, m) pidx_set(*pr, i, b[pidx_get(*pr, i)]);
+	emem_free(b);
+	return m;
+}
+
+/* Suffix array, LCP and left context of s with a separator per file of the
+ * charmap cname (see fsep.h). Returns FALSE on error. */
+static bool fsep_index(uchar* s, uidx sn, const char* cname, pidx** pr, lcp_array* h,
+	left_ctx* lc, uint cl, uidx maxl, double* t_sarr, double* t_lcp) {
+	TIME_RUN_INIT
+	uidx *fs, *p, *r;
+	uidx nf;
+	pidx* pp;
+	if (!(fs = fsep_load(cname, sn, &nf))) return FALSE;
+	p = (uidx*)emem_malloc(sn*sizeof(uidx));
+	r = (uidx*)emem_malloc(sn*sizeof(uidx));
+	TIME_RUN_AC(*t_sarr,fsep_sa(s, sn, fs, nf, r, p, lc))
+	*pr = pidx_pack(r, sn);
+	pp = pidx_pack(p, sn);
+	TIME_RUN_AC(*t_lcp,plcp_lcp(h, sn, *pr, pp, cl, maxl))
+	emem_free(pp);
+	pz_free(fs);
+	return TRUE;
+}
+
+/* Suffix array (of tokens in *r, of their byte positions in *pr), LCP in
+ * tokens and left context of the token stream ts (see tok.h). */
+static void tok_index(tok_stream* ts, uidx** r, pidx** pr, lcp_array* h, left_ctx* lc,
+	uint cl, double* t_sarr, double* t_lcp) {
+	TIME_RUN_INIT
+	uidx *p, i, m = ts->m;
+	pidx *pp, *tr;
+	p = (uidx*)emem_malloc(m*sizeof(uidx));
+	*r = (uidx*)emem_malloc(m*sizeof(uidx));
+	TIME_RUN_AC(*t_sarr,tok_sa(ts, *r, p, lc))
+	/* packed for the LCP; the token kernels want r plain again */
+	tr = pidx_pack(*r, m);
+	pp = pidx_pack(p, m);
+	TIME_RUN_AC(*t_lcp,plcp_lcp(h, m, tr, pp, cl, 0))
+	emem_free(pp);
+	*r = pidx_unpack(tr, m);
+	*pr = pidx_malloc(m);
+	forn(i, m) pidx_set(*pr, i, ts->sp[2*(*r)[i]]);
+}
+
+/*** Rivals ***/
+
+typedef struct {
+	uchar* s;
+	uidx sn;
+	uchar** fn;        /* fn[1..] are the rivals */
+	uint c, v, cl;
+	uint threads;      /* for the SA and LCP of each rival */
+	sa_builder* sa_build;
+	occ_index* oc;     /* -ms: index of s (r, h) to match the rivals against */
+	pidx* r;
+	lcp_array* h;
+	pidx* mc;
+	uidx** acc;        /* m folded by each worker, NULL to fold into mc */
+	pthread_mutex_t mx;
+	double t_sarr, t_lcp, t_mcalc;
+} rival_ctx;
+
+typedef struct {
+	rival_ctx* rc;
+	uidx i, b, e;
+} rival_job;
+
+/* Folds m into mc or into the accumulator of the worker th */
+static void rival_fold(rival_ctx* rc, uidx* m, uint th) {
+	uidx j, *a;
+	if (!rc->acc) {
+		if (rc->c) csu(rc->mc, m, rc->sn);
+		else opu(rc->mc, m, rc->sn);
+		return;
+	}
+	if (!(a = rc->acc[th])) {
+		rc->acc[th] = a = (uidx*)emem_malloc(rc->sn*sizeof(uidx));
+		memcpy(a, m, rc->sn*sizeof(uidx));
+	} else if (rc->c) {
+		forn(j, rc->sn) if (m[j] < a[j]) a[j] = m[j];
+	} else {
+		forn(j, rc->sn) if (m[j] > a[j]) a[j] = m[j];
+	}
+}
+
+/* Maximum common lengths of s with the rival i, folded */
+static void rival_run(void* arg, uint th) {
+	TIME_RUN_INIT
+	rival_job* jb = (rival_job*)arg;
+	rival_ctx* rc = jb->rc;
+	uidx *p, *r, *m, tn, n, j, sn = rc->sn;
+	uchar *t, *st;
+	pidx *pr, *pp;
+	lcp_array h;
+	bwt_opts bo;
+	bool tmapped;
+	double t_sarr = 0.0, t_lcp = 0.0, t_mcalc = 0.0;
+
+	t = mapStrFileExtraSpace((const char*)rc->fn[jb->i], &tn, 1, &tmapped);
+	if (t == NULL) return; // Maybe immediately exit the program ?
+
+	t[tn++] = 254;
+	if (rc->v) {
+		flockfile(stderr);
+		fprintf(stderr, "Rival " UIDX_FMT "\n", jb->i);
+		forn(j,tn-1) fprintf(stderr, "%c", t[j]);
+		fprintf(stderr, "\n");
+		funlockfile(stderr);
+	}
+
+	if (rc->oc) {
+		m = (uidx*)emem_malloc(sn*sizeof(uidx));
+		TIME_RUN_AC(t_mcalc,mcl_ms(rc->oc, rc->s, rc->r, rc->h, sn, t, tn, m))
+		unmapStrFile(t, tn-1, 1, tmapped);
+		TIME_RUN_AC(t_mcalc,rival_fold(rc, m, th))
+		emem_free(m);
+	} else {
+		n = sn + tn;
+		st = (uchar*)pz_malloc(n*sizeof(uchar));	
+		memcpy(st, rc->s, sn);
+		memcpy(st+sn, t, tn);
+		unmapStrFile(t, tn-1, 1, tmapped);
+		
+		p = (uidx*)emem_malloc(n*sizeof(uidx));
+		r = (uidx*)emem_malloc(n*sizeof(uidx));
+
+		bo.threads = rc->threads; bo.maxdepth = 0;
+		TIME_RUN_AC(t_sarr,rc->sa_build(NULL, p, r, st, n, NULL, &bo))
+		pr = pidx_pack(r, n);
+		pp = pidx_pack(p, n);
+		TIME_RUN_AC(t_lcp,build_lcp(&h, n, st, pr, pp, rc->cl, FALSE, rc->threads, 0))
+		emem_free(pp);
+		m = (uidx*)emem_malloc(sn*sizeof(uidx));
+		TIME_RUN_AC(t_mcalc,mcl(pr, &h, n, m, sn))
+		TIME_RUN_AC(t_mcalc,rival_fold(rc, m, th))
+
+		lcpa_free(&h);
+		emem_free(pr);
+		emem_free(m);
+		pz_free(st);
+	}
+
+	pthread_mutex_lock(&rc->mx);
+	rc->t_sarr += t_sarr; rc->t_lcp += t_lcp; rc->t_mcalc += t_mcalc;
+	pthread_mutex_unlock(&rc->mx);
+}
+
+/* Folds the accumulators into mc over [b, e) */
+static void rival_reduce(void* arg, uint th) {
+	rival_job* jb = (rival_job*)arg;
+	rival_ctx* rc = jb->rc;
+	uidx j;
+	uint k;
+	(void)th;
+	forn(k, jb->i) if (rc->acc[k]) forsn(j, jb->b, jb->e) {
+		if (rc->c ? rc->acc[k][j] < pidx_get(rc->mc, j) : rc->acc[k][j] > pidx_get(rc->mc, j))
+			pidx_set(rc->mc, j, rc->acc[k][j]);
+	}
+}
+
+/* Rivals processed at once: up to threads (and rivals), as many as fit in
+ * the budget */
+static uint rival_workers(uchar** fn, uint at, uidx sn, bool ms, uint threads) {
+	uint64 tmax = 0, need, w;
+	long long tn;
+	uint i;
+	if (threads > at-1) threads = at-1;
+	if (threads <= 1 || !emem_budget()) return threads ? threads : 1;
+	forsn(i, 1, at) if ((tn = filesize((const char*)fn[i])) > 0 && (uint64)tn > tmax) tmax = tn;
+	need = ms ? (3 * (uint64)sn + tmax) * sizeof(uidx)
+		: (3 * sizeof(uidx) + 1) * ((uint64)sn + tmax + 1);
+	need += (uint64)sn * sizeof(uidx);
+	w = emem_budget() / need;
+	return w < 1 ? 1 : w < threads ? w : threads;
+}
+
+/* Runs the rivals 1..at-1 on workers threads. Each of them builds its
+ * SA and LCP with threads / workers threads (at least 1). */
+static void rival_all(rival_ctx* rc, uint at, uint workers, uint threads) {
+	psort ps;
+	rival_job* jb;
+	uidx i, nb, step;
+	rc->threads = threads / workers ? threads / workers : 1;
+	rc->acc = workers > 1 ? (uidx**)pz_malloc(workers * sizeof(uidx*)) : NULL;
+	if (rc->acc) memset(rc->acc, 0, workers * sizeof(uidx*));
+	psort_init(&ps, workers);
+	jb = (rival_job*)pz_malloc(at * sizeof(rival_job));
+	forsn(i, 1, at) {
+		jb[i].rc = rc; jb[i].i = i;
+		psort_job_new(&ps, rival_run, &jb[i]);
+	}
+	psort_wait(&ps);
+	pz_free(jb);
+
+	if (rc->acc) {
+		nb = 4 * workers;
+		step = (rc->sn + nb - 1) / nb;
+		jb = (rival_job*)pz_malloc(nb * sizeof(rival_job));
+		forn(i, nb) {
+			jb[i].rc = rc; jb[i].i = workers;
+			jb[i].b = i * step < rc->sn ? i * step : rc->sn;
+			jb[i].e = jb[i].b + step < rc->sn ? jb[i].b + step : rc->sn;
+			psort_job_new(&ps, rival_reduce, &jb[i]);
+		}
+		psort_wait(&ps);
+		pz_free(jb);
+		forn(i, workers) emem_free(rc->acc[i]);
+		pz_free(rc->acc);
+	}
+	psort_destroy(&ps);
+}
+
 int main(int argc, char** argv) {
 	TIME_RUN_INIT
-	uint *p, *r, *h, *m, *mc, tn;
-	uchar *s, *st, *t;
-	char *outfile;
+	uidx *p = NULL, *tr = NULL;
+	lcp_array h;
+	pidx *pr, *mc;
+	uchar *s;
+	char *outfile = NULL, *idxname = NULL, *bname = NULL, *cname = NULL, *tname = NULL;
 	uchar **filenames;
-	uint sn,n,i,j,ml = 1, nm = 0, c = 0, v = 0, at = 0, time = 0;
+	uidx sn,nx,i,ml = 1,maxl = 0;
+	uint nm = 0, sm = 0, ms = 0, bin = 0, c = 0, v = 0, at = 0, time = 0, is = 0, cl = 0, threads = 1, param = 0;
+	bool low = FALSE;
+	uint64 budget = 0;
+	bool smapped;
+	idxfile ix;
+	occ_index oc;
+	rival_ctx rc;
+	ow w;
+	left_ctx lc;
 	int ps = -1;
 	filter_data fdata;
+	repeat_filter_data rf;
+	uint noblank = 0, nonull = 0;
+	tok_stream ts;
+	tok_data tdata;
+	tok_param_data tpdata;
+	output_callback* kernel_out = own_filter_callback;
+	void* kernel_data = &fdata;
+	sa_builder* sa_build;
 	double t_sarr = 0.0,t_lcp = 0.0,t_mcalc = 0.0,t_algo = 0.0;
 
+	memset(&rf, 0, sizeof(repeat_filter_data));
 	forsn(i, 1, argc) {
 		if (0) {}
 		else cmdline_opt_2(i, "-ml") { ml = atoi(argv[i]); }
+		else cmdline_opt_2(i, "-maxl") { maxl = atoi(argv[i]); }
 		else cmdline_opt_2(i, "-o") { outfile = argv[i]; }
+		else cmdline_opt_2(i, "-idx") { idxname = argv[i]; }
+		else cmdline_opt_2(i, "-sparse") { bname = argv[i]; }
+		else cmdline_opt_2(i, "-files") { cname = argv[i]; }
+		else cmdline_opt_2(i, "-tok") { tname = argv[i]; }
+		else cmdline_opt_2(i, "-threads") { threads = atoi(argv[i]); }
+		else cmdline_opt_2(i, "--mem-budget") {
+			if (!emem_parse_size(argv[i], &budget)) {
+				fprintf(stderr, "filecop: bad --mem-budget %s (a size like 512M or 4G)\n", argv[i]);
+				return 1;
+			}
+		}
+		else cmdline_opt_1(i, "--low-mem") { low = TRUE; }
+		else cmdline_opt_2(i, "-minocc") { rf.minocc = atoi(argv[i]); }
+		else cmdline_opt_2(i, "-maxocc") { rf.maxocc = atoi(argv[i]); }
+		else cmdline_opt_2(i, "-minlines") { rf.minlines = atoi(argv[i]); }
 		else cmdline_var(i, "nm", nm)
+		else cmdline_var(i, "sortmrs", sm)
 		else cmdline_var(i, "c", c)
+		else cmdline_var(i, "ms", ms)
+		else cmdline_var(i, "b", bin)
 		else cmdline_var(i, "v", v)
 		else cmdline_var(i, "t", time)
+		else cmdline_var(i, "sais", is)
+		else cmdline_var(i, "clcp", cl)
+		else cmdline_var(i, "param", param)
+		else cmdline_var(i, "noblank", noblank)
+		else cmdline_var(i, "nonull", nonull)
 		else {
 			if (ps == -1) ps = i;
 			if (ps+at != i) at = -argc-1;
@@ -56,23 +435,87 @@ int main(int argc, char** argv) {
 		}
 	}
 	
-	if (at < 1 || (nm && c)) {
+	if (at < 1 || (nm && c) || ((bname || cname || tname) && (c || ms))
+		|| (!!bname + !!cname + !!tname > 1) || (tname && bin) || (param && !tname)
+		|| (maxl && (c || ms || tname)) || (low && (bname || cname || tname))
+		|| ((rf.minocc || rf.maxocc) && c)) {
 		fprintf(stderr, "Usage: %s <file> <file1> [<file2>] [<file3>]"
 						" ... [options] \n"
 						"  -nm will run mrs instead of mmrs\n"
+						"  -sortmrs with -nm, runs the sort based mrs instead of the stack based one;\n"
+						"    the same repeats, written by increasing length instead of in suffix\n"
+						"    array order\n"
 						"  -ml <number> will use <number> as ml parameter\n"
+						"  -maxl <number> caps the repeats at <number> characters: the suffixes are\n"
+						"    only sorted that deep, and longer repeats are reported by their first\n"
+						"    <number> characters. Not with -c, -ms or -tok, ignores -sortmrs and -idx\n"
 						"  -c will find common patterns instead of own (default)\n"
+						"  -b writes the repeats as a binary stream (see output_callbacks.h)\n"
+						"  -ms indexes <file> once and matches each rival against it, instead of\n"
+						"    sorting <file> again together with every rival; not used if <file>\n"
+						"    has a 255 byte\n"
 						"  -v gives more output in standard error (only to be used with pure text files)\n"
 						"  -t calculates running times (no data output)\n"
+						"  -idx <file> loads the suffix and LCP arrays of <file> from this index\n"
+						"    file, or saves them there if it is missing or out of date\n"
+						"  -sais builds the suffix arrays with SA-IS instead of prefix doubling\n"
+						"  -threads <number> builds the suffix and LCP arrays, and runs mmrs, with\n"
+						"    <number> threads; with several rivals, runs up to <number> of them at\n"
+						"    once (fewer if they do not fit in --mem-budget)\n"
+						"  -sparse <file> indexes only the suffixes starting at the boundaries\n"
+						"    marked in <file> (see the preprocessor's --bounds); not with -c or -ms,\n"
+						"    ignores -sortmrs and -idx\n"
+						"  -files <charmap> places a distinct separator before each file start in\n"
+						"    <charmap> (as written by the preprocessor), so no repeat spans two\n"
+						"    files; not with -c, -ms or -sparse, ignores -sortmrs and -idx\n"
+						"  -tok <file> finds the repeats over the tokens of <file> (see the\n"
+						"    preprocessor's --tokens); -ml is still in bytes. Not with -c, -ms, -b,\n"
+						"    -sparse or -files, ignores -sortmrs and -idx\n"
+						"  -param with -tok, reports the parameterized repeats: the same tokens\n"
+						"    up to a consistent renaming of the identifiers\n"
+						"  -clcp keeps the LCP array in one byte per entry plus exceptions (always\n"
+						"    on in LARGE_INDEX builds)\n"
+						"  -minocc <number>, -maxocc <number> only report the repeats with at least,\n"
+						"    or at most, <number> occurrences (counted before the postprocessor\n"
+						"    splits them at file boundaries). Not with -c, whose repeats are\n"
+						"    reported once each\n"
+						"  -noblank drops the repeats made only of blanks and control characters\n"
+						"  -nonull drops the repeats made only of null bytes\n"
+						"  -minlines <number> drops the repeats spanning fewer than <number> lines\n"
+						"  --mem-budget <size> keeps at most <size> bytes (K, M, G suffixes) of the\n"
+						"    big arrays in RAM and maps the rest to temporary files ($TMPDIR); the\n"
+						"    suffix array is then sorted with external sorts and the LCP in blocks,\n"
+						"    in sequential passes, so mmrs can index several times the RAM (the\n"
+						"    text itself is read at random; -nm and rivals read the arrays at\n"
+						"    random too). Implies -sais while the arrays fit\n"
+						"  --low-mem builds the index in about 9n bytes (n the size of <file>, 11n\n"
+						"    with LARGE_INDEX) and shows the peak of each phase in standard error;\n"
+						"    implies -sais and -clcp, ignores -sortmrs. Not with -sparse, -files or\n"
+						"    -tok\n"
 						, argv[0]); 
 		return 1;
 	}
 	
+	emem_init(budget, NULL);
+	/* SA-IS only needs r, and the LCP goes compressed over p */
+	if (low) { is = 1; cl = 1; sm = 0; }
+#ifdef LARGE_INDEX
+	/* a plain LCP entry takes 8 bytes here, a compressed one about 1 */
+	cl = 1;
+#endif
+	sa_build = budget? esa_bwt: is? sais_bwt: bwt;
+
 	filenames = (uchar**)pz_malloc(at*sizeof(uchar*));
 	forn(i,at) filenames[i] = (uchar*)argv[ps+i];
 	
-	s = loadStrFileExtraSpace((const char*)filenames[0], &sn, 1);
+	s = mapStrFileExtraSpace((const char*)filenames[0], &sn, 1, &smapped);
 	s[sn++] = 255;
+	/* -ms sorts the rotations of s, which are not its suffixes if the
+	 * sentinel occurs before the end */
+	if (ms && memchr(s, 255, sn-1)) {
+		fprintf(stderr, "filecop: 255 in <file>, not using -ms\n");
+		ms = 0;
+	}
 	
 	if (v) {
 		fprintf(stderr, "Base string\n");
@@ -80,63 +523,79 @@ int main(int argc, char** argv) {
 		fprintf(stderr, "\n");
 	}
 
-	mc = (uint*)pz_malloc(sn*sizeof(uint));
+	/* without rivals, nothing filters the own repeats */
+	mc = c || at > 1 ? pidx_malloc(sn) : NULL;
 	if (c) {
-		forn(i,sn) mc[i] = sn;
-	} else {
-		forn(i,sn) mc[i] = 0;
+		forn(i,sn) pidx_set(mc, i, sn);
+	} else if (mc) {
+		forn(i,sn) pidx_set(mc, i, 0);
 	}
 	
-	forsn(i, 1, at){
-		t = loadStrFileExtraSpace((const char*)filenames[i], &tn, 1);
-		if (t == NULL) continue; // Maybe immediately exit the program ?
-
-		t[tn++] = 254;
-		if (v) {
-			fprintf(stderr, "Rival %u\n", i);
-			forn(j,tn-1) fprintf(stderr, "%c", t[j]);
-			fprintf(stderr, "\n");
-		}
+	/* With -ms, s is indexed once and the rivals are placed on it */
+	if (ms) {
+		p = base_index(s, sn, idxname, &ix, &pr, &h, &lc, nm && sm, low, sa_build, cl, threads, 0, &t_sarr, &t_lcp);
+		if (at > 1) TIME_RUN_AC(t_mcalc,occ_build(&oc, &lc, sn))
+	}
 
-		n = sn + tn;
-		st = (uchar*)pz_malloc(n*sizeof(uchar));	
-		memcpy(st, s, sn);
-		memcpy(st+sn, t, tn);
-		free(t);
-		
-		p = (uint*)pz_malloc(n*sizeof(uint));
-		r = (uint*)pz_malloc(n*sizeof(uint));
-		h = (uint*)pz_malloc(n*sizeof(uint));
-
-		TIME_RUN_AC(t_sarr,bwt(NULL, p, r, st, n, NULL))
-		forn(j,n) p[r[j]]=j;
-		memcpy(h, r, n*sizeof(uint));
-		TIME_RUN_AC(t_lcp,lcp(n, st, h, p))
-		m = p; //place m on p to save memory
-		TIME_RUN_AC(t_mcalc,mcl(r, h, n, m, sn))
-		if (c) TIME_RUN_AC(t_mcalc,csu(mc,m,sn))
-		else TIME_RUN_AC(t_mcalc,opu(mc,m,sn))
-
-		pz_free(h);
-		pz_free(r);
-		pz_free(p);
-		pz_free(st);
-		
+	if (at > 1) {
+		rc.s = s; rc.sn = sn;
+		rc.fn = filenames;
+		rc.c = c; rc.v = v; rc.cl = cl;
+		rc.sa_build = sa_build;
+		rc.oc = ms ? &oc : NULL;
+		rc.r = pr; rc.h = &h;
+		rc.mc = mc;
+		rc.t_sarr = rc.t_lcp = rc.t_mcalc = 0.0;
+		pthread_mutex_init(&rc.mx, NULL);
+		rival_all(&rc, at, rival_workers(filenames, at, sn, ms, threads), threads);
+		pthread_mutex_destroy(&rc.mx);
+		t_sarr += rc.t_sarr; t_lcp += rc.t_lcp; t_mcalc += rc.t_mcalc;
+		if (ms) occ_free(&oc);
+		/* the repeats are compared capped, as they are found */
+		if (maxl) forn(i,sn) if (pidx_get(mc, i) > maxl) pidx_set(mc, i, maxl);
+		if (low) mem_phase("Rivals", sn);
 	}
 	
-	p = (uint*)pz_malloc(sn*sizeof(uint));
-	r = (uint*)pz_malloc(sn*sizeof(uint));
-	h = (uint*)pz_malloc(sn*sizeof(uint));
-	
-	TIME_RUN_AC(t_sarr,bwt(NULL, p, r, s, sn, NULL))
-	forn(j,sn) p[r[j]]=j;
-	memcpy(h, r, sn*sizeof(uint));
-	TIME_RUN_AC(t_lcp,lcp(sn, s, h, p))
+	nx = sn;
+	if (bname) {
+		memset(&ix, 0, sizeof(idxfile));
+		if (!(nx = sparse_index(s, sn, bname, &pr, &h, &lc, cl, maxl, &t_sarr, &t_lcp))) return 1;
+		sm = 0;
+	} else if (cname) {
+		memset(&ix, 0, sizeof(idxfile));
+		if (!fsep_index(s, sn, cname, &pr, &h, &lc, cl, maxl, &t_sarr, &t_lcp)) return 1;
+		sm = 0;
+	} else if (tname) {
+		memset(&ix, 0, sizeof(idxfile));
+		if (!tok_load(&ts, tname, sn)) return 1;
+		if (param) tok_param(&ts);
+		tok_index(&ts, &tr, &pr, &h, &lc, cl, &t_sarr, &t_lcp);
+		nx = ts.m;
+		sm = 0;
+		/* the kernels see tokens, the filter and the output bytes */
+		tdata.ts = &ts; tdata.r = tr; tdata.ml = ml;
+		tdata.callback = own_filter_callback; tdata.data = &fdata;
+		kernel_out = tok_callback; kernel_data = &tdata;
+		/* over the skeleton, split each repeat by renaming first */
+		if (param) {
+			tok_param_init(&tpdata, &ts, tr, pr, nm ? &h : NULL, tok_callback, &tdata);
+			kernel_out = tok_param_callback; kernel_data = &tpdata;
+		}
+		ml = 1;
+	} else if (!ms) {
+		/* the inverse of a partial order does not give the left contexts of
+		 * mrs(), and the index would not be the complete one */
+		if (maxl) { sm = 0; idxname = NULL; }
+		p = base_index(s, sn, idxname, &ix, &pr, &h, &lc, nm && sm, low, sa_build, cl, threads, maxl, &t_sarr, &t_lcp);
+	}
 
 	output_readable_data ord;
-	ord.r = r;
+	ord.r = pr;
 	ord.s = s;
 	ord.a = 0;
+	ord.w = &w;
+	ord.pos = NULL;
+	ord.pos_size = 0;
     if (outfile == NULL) {
         ord.fp = stdout;
     } else {
@@ -148,19 +607,32 @@ int main(int argc, char** argv) {
         }
     }
 
-    output_callback *callback = time? output_nothing: output_findmaxrep;
+    output_callback *callback = time? output_nothing: bin? output_binary: output_findmaxrep;
+	void* cbdata = &ord;
+	ow_init(&w, ord.fp, OW_BUFFER, 2);
+	if (bin && !time) output_binary_header(&w);
+
+	/* the repeats are filtered before anything is formatted */
+	rf.noblank = noblank; rf.nonull = nonull;
+	if (repeat_filter_any(&rf)) {
+		rf.s = s; rf.r = pr;
+		rf.callback = callback; rf.data = &ord;
+		callback = repeat_filter_callback; cbdata = &rf;
+	}
 
 	if (!c) {
-		fdata.data = (void*) &ord;
+		fdata.data = cbdata;
 		fdata.filter = mc;
-		fdata.r = r;
+		fdata.r = pr;
 		fdata.callback = callback;
 		
-		if (nm) TIME_RUN_AC(t_algo,mrs(s, sn, r, h, p, ml, own_filter_callback, &fdata))	
-		else TIME_RUN_AC(t_algo,mmrs(s, sn, r, h, ml, own_filter_callback, &fdata))
+		if (nm && sm) TIME_RUN_AC(t_algo,mrs(&lc, nx, pr, &h, p, ml, threads, kernel_out, kernel_data))
+		else if (nm) TIME_RUN_AC(t_algo,smrs(&lc, nx, &h, ml, kernel_out, kernel_data))
+		else TIME_RUN_AC(t_algo,mmrs(&lc, nx, &h, ml, threads, kernel_out, kernel_data))
 	} else {	
-		TIME_RUN_AC(t_algo,common_substrings(s, sn, r, mc, h, ml, callback, &ord));
+		TIME_RUN_AC(t_algo,common_substrings(s, sn, pr, mc, &h, ml, callback, cbdata));
 	}
+	if (low) mem_phase("Repeats", sn);
 	
 	if (time) {
 		printf("         Suffix array calculations: %.2lf ms\n", t_sarr);
@@ -169,12 +641,29 @@ int main(int argc, char** argv) {
 		printf("                    Main algorithm: %.2lf ms\n", t_algo);
 	}
 	
-	free(s);
+	pz_free(ord.pos);
+	if (!ow_close(&w)) {
+		fprintf(stderr, "Output %s [%s]\n", outfile ? outfile : "stdout", strerror(errno));
+		return 1;
+	}
+	if (outfile) fclose(ord.fp);
+	unmapStrFile(s, sn-1, 1, smapped);
 	
-	pz_free(p);
-	pz_free(r);
-	pz_free(h);
-	pz_free(mc);
+	emem_free(p);
+	if (tname) {
+		if (param) tok_param_free(&tpdata);
+		emem_free(tr);
+		tok_free(&ts);
+	}
+	if (ix.map) {
+		idxf_close(&ix);
+	} else {
+		emem_free(pr);
+		emem_free(lc.bw);
+		emem_free(lc.lid);
+		lcpa_free(&h);
+	}
+	emem_free(mc);
 	pz_free(filenames);
 
 	return 0;
@@ -0,0 +1,88 @@
+#include "fsep.h"
+#include "sais.h"
+#include "emem.h"
+#include "macros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define NONE ((uidx)-1)
+#define SEP(f) (256 + (f))
+/* t[j] is a separator (the sentinel, the last symbol, is not) */
+#define is_sep(j) ((j) < N-1 && t[j] >= 256)
+
+uidx* fsep_load(const char* fn, uidx n, uidx* nf) {
+	FILE* f;
+	unsigned long long x;
+	uidx k = 0, sz = 1024;
+	uidx* fs;
+	int c;
+	if (!(f = fopen(fn, "r"))) {
+		fprintf(stderr, "Charmap %s [%s]\n", fn, strerror(errno));
+		return NULL;
+	}
+	fs = (uidx*)pz_malloc(sz * sizeof(uidx));
+	while (fscanf(f, "%llu", &x) == 1) {
+		/* empty files share their start with the next one */
+		if (x > 0 && x < n-1 && (!k || x > fs[k-1])) {
+			if (k == sz) { sz *= 2; fs = (uidx*)pz_realloc(fs, sz * sizeof(uidx)); }
+			fs[k++] = x;
+		}
+		while ((c = fgetc(f)) != EOF && c != '\n');
+	}
+	fclose(f);
+	*nf = k;
+	return fs;
+}
+
+void fsep_sa(uchar* s, uidx n, uidx* fs, uidx nf, uidx* r, uidx* p, left_ctx* lc) {
+	uidx i, j, k, x, f, l, N = n + nf, K = SEP(nf) + 1;
+	uidx *t, *sa, *ph;
+
+	t = (uidx*)emem_malloc(N * sizeof(uidx));
+	for(i = j = f = 0; i < n-1; ++i) {
+		if (f < nf && fs[f] == i) t[j++] = SEP(f++);
+		t[j++] = s[i];
+	}
+	t[j] = SEP(nf);
+	sa = (uidx*)emem_malloc(N * sizeof(uidx));
+	sais_int(t, sa, N, K);
+
+	/* Drop the separators, keeping the previous symbol of the rest */
+	memset(lc, 0, sizeof(left_ctx));
+	lc->lid = (uidx*)emem_malloc(n * sizeof(uidx));
+	lc->nid = K;
+	for(i = x = 0; i < N; ++i) {
+		if (is_sep(j = sa[i])) continue;
+		if (j) lc->lid[x] = t[j-1];
+		else { lc->lid[x] = 0; lc->prim = x; }
+		sa[x++] = j;
+	}
+
+	/* Phi and PLCP over the positions of t; the separators are unique, so
+	 * they end every common prefix */
+	ph = (uidx*)emem_malloc(N * sizeof(uidx));
+	ph[sa[0]] = NONE;
+	forsn(i, 1, n) ph[sa[i]] = sa[i-1];
+	l = 0;
+	forn(j, N) {
+		if (is_sep(j)) { l = 0; continue; }
+		if ((k = ph[j]) == NONE) l = 0;
+		else while (j+l < N && k+l < N && t[j+l] == t[k+l]) ++l;
+		ph[j] = l;
+		if (l) --l;
+	}
+
+	/* Back to the positions of s, t[j] becoming the position of j */
+	for(j = x = 0; j < N; ++j) {
+		if (is_sep(j)) continue;
+		p[x] = ph[j];
+		t[j] = x++;
+	}
+	forn(i, n) r[i] = t[sa[i]];
+	emem_free(ph);
+	emem_free(sa);
+	emem_free(t);
+}
@@ -0,0 +1,32 @@
+#ifndef __FSEP_H__
+#define __FSEP_H__
+
+#include "tipos.h"
+#include "bwt.h"
+
+/** Suffix array of a concatenation of files with a separator per file.
+ *
+ * The text is sorted as a string of integers: the bytes keep their values
+ * [0, 256), a distinct symbol 256+f is placed before the start of each file
+ * f but the first, and the end is a symbol larger than all of them. No two
+ * suffixes share a separator, so no common prefix (and no repeat) goes
+ * across a file boundary, and the bytes 254 and 255 are plain characters.
+ * The separators are dropped from the output, which is indexed by the
+ * positions of the text as usual.
+ */
+
+/** Reads the file starts from the charmap written by the preprocessor
+ * (lines "<offset>\t<path>") for a text of n bytes, the last one being the
+ * sentinel. Returns the starts in (0, n-1), increasing, and their number in
+ * *nf. NULL if the charmap can not be read. */
+uidx* fsep_load(const char* fn, uidx n, uidx* nf);
+
+/** Sorts the suffixes of s (of length n, s[n-1] being the sentinel) with a
+ * separator before each of the nf file starts fs.
+ * r gets the suffix array and p the PLCP (as lcp_plcp() leaves it), both
+ * over the positions of s. lc gets the previous symbol of each suffix in
+ * lid (allocated with emem_malloc()), the separator for the files starts.
+ */
+void fsep_sa(uchar* s, uidx n, uidx* fs, uidx nf, uidx* r, uidx* p, left_ctx* lc);
+
+#endif //__FSEP_H__
@@ -0,0 +1,150 @@
+#include "idxfile.h"
+#include "macros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#define IDXF_ALIGN(x) (((x) + 7) & ~(uint64)7)
+
+uint64 idxf_checksum(uchar* s, uidx n) {
+	uint64 h = 0x243F6A8885A308D3ULL ^ (uint64)n, w;
+	uidx i;
+	for(i = 0; i + sizeof(uint64) <= n; i += sizeof(uint64)) {
+		memcpy(&w, s+i, sizeof(uint64));
+		h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+		h ^= h >> 29;
+	}
+	for(; i < n; ++i) {
+		h = (h ^ s[i]) * 0x9E3779B97F4A7C15ULL;
+		h ^= h >> 29;
+	}
+	return h;
+}
+
+bool idxf_open(idxfile* ix, const char* fn, uidx n, uint64 checksum) {
+	struct stat st;
+	idxf_header* hd;
+	uchar* base;
+	uint i;
+	int fd;
+	memset(ix, 0, sizeof(idxfile));
+	if ((fd = open(fn, O_RDONLY)) == -1) return FALSE;
+	if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(idxf_header)) {
+		close(fd);
+		return FALSE;
+	}
+	base = (uchar*)mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		fprintf(stderr, "Index %s [%s]\n", fn, strerror(errno));
+		return FALSE;
+	}
+	hd = (idxf_header*)base;
+	if (memcmp(hd->magic, IDXF_MAGIC, sizeof(hd->magic)) || hd->version != IDXF_VERSION
+		|| hd->width != sizeof(uidx) || hd->pwidth != PIDX_BYTES
+		|| hd->n != n || hd->checksum != checksum) {
+		fprintf(stderr, "Index %s does not match the input, rebuilding it\n", fn);
+		munmap(base, st.st_size);
+		return FALSE;
+	}
+	forn(i, IDXF_NSECT) if (hd->off[i] + hd->len[i] > (uint64)st.st_size) {
+		fprintf(stderr, "Index %s is truncated, rebuilding it\n", fn);
+		munmap(base, st.st_size);
+		return FALSE;
+	}
+#ifdef MADV_WILLNEED
+	madvise(base, st.st_size, MADV_WILLNEED);
+#endif
+	ix->map = base;
+	ix->size = st.st_size;
+	ix->r = (pidx*)(base + hd->off[IDXF_R]);
+	ix->lc.bw = base + hd->off[IDXF_BWT];
+	ix->lc.prim = hd->prim;
+	ix->h.n = n;
+	if (hd->clcp) {
+		ix->h.v = base + hd->off[IDXF_V];
+		ix->h.ex = (uint64*)(base + hd->off[IDXF_EX]);
+		ix->h.rk = (uidx*)(base + hd->off[IDXF_RK]);
+		ix->h.big = (uidx*)(base + hd->off[IDXF_BIG]);
+	} else {
+		ix->h.h = (uidx*)(base + hd->off[IDXF_H]);
+	}
+	fprintf(stderr, "Loaded index %s\n", fn);
+	return TRUE;
+}
+
+void idxf_close(idxfile* ix) {
+	if (ix->map) munmap(ix->map, ix->size);
+	memset(ix, 0, sizeof(idxfile));
+}
+
+/* Writes a section at the current offset, padded to 8 bytes */
+static bool idxf_write(FILE* f, uint64* off, const void* buf, uint64 len) {
+	static const uchar zero[8];
+	uint64 pad = IDXF_ALIGN(*off + len) - (*off + len);
+	if (len && fwrite(buf, 1, len, f) != len) return FALSE;
+	if (pad && fwrite(zero, 1, pad, f) != pad) return FALSE;
+	*off += len + pad;
+	return TRUE;
+}
+
+bool idxf_save(const char* fn, uidx n, uint64 checksum, pidx* r, lcp_array* h, left_ctx* lc) {
+	idxf_header hd;
+	char* tmp;
+	uint64 off, nw = (n + 63) / 64, nbig = 0;
+	uidx i;
+	bool ok = TRUE;
+	FILE* f;
+
+	memset(&hd, 0, sizeof(hd));
+	memcpy(hd.magic, IDXF_MAGIC, sizeof(hd.magic));
+	hd.version = IDXF_VERSION;
+	hd.width = sizeof(uidx);
+	hd.pwidth = PIDX_BYTES;
+	hd.clcp = h->h == NULL;
+	hd.n = n;
+	hd.checksum = checksum;
+	hd.prim = lc->prim;
+	if (hd.clcp) forn(i, n) nbig += h->v[i] == LCPA_ESC;
+	hd.len[IDXF_R] = (uint64)n * PIDX_BYTES;
+	hd.len[IDXF_H] = hd.clcp ? 0 : (uint64)n * sizeof(uidx);
+	hd.len[IDXF_V] = hd.clcp ? n : 0;
+	hd.len[IDXF_EX] = hd.clcp ? nw * sizeof(uint64) : 0;
+	hd.len[IDXF_RK] = hd.clcp ? nw * sizeof(uidx) : 0;
+	hd.len[IDXF_BIG] = nbig * sizeof(uidx);
+	hd.len[IDXF_BWT] = n;
+	off = IDXF_ALIGN(sizeof(hd));
+	forn(i, IDXF_NSECT) { hd.off[i] = off; off = IDXF_ALIGN(off + hd.len[i]); }
+
+	/* Written aside and renamed, so a reader never sees half a file */
+	tmp = (char*)pz_malloc(strlen(fn) + 5);
+	sprintf(tmp, "%s.tmp", fn);
+	if (!(f = fopen(tmp, "wb"))) {
+		fprintf(stderr, "Index %s [%s]\n", tmp, strerror(errno));
+		pz_free(tmp);
+		return FALSE;
+	}
+	off = 0;
+	ok = ok && idxf_write(f, &off, &hd, sizeof(hd));
+	ok = ok && idxf_write(f, &off, r, hd.len[IDXF_R]);
+	ok = ok && idxf_write(f, &off, h->h, hd.len[IDXF_H]);
+	ok = ok && idxf_write(f, &off, h->v, hd.len[IDXF_V]);
+	ok = ok && idxf_write(f, &off, h->ex, hd.len[IDXF_EX]);
+	ok = ok && idxf_write(f, &off, h->rk, hd.len[IDXF_RK]);
+	ok = ok && idxf_write(f, &off, h->big, hd.len[IDXF_BIG]);
+	ok = ok && idxf_write(f, &off, lc->bw, hd.len[IDXF_BWT]);
+	ok = fclose(f) == 0 && ok;
+	if (ok) ok = rename(tmp, fn) == 0;
+	if (!ok) {
+		fprintf(stderr, "Index %s [%s]\n", fn, strerror(errno));
+		unlink(tmp);
+	}
+	pz_free(tmp);
+	return ok;
+}
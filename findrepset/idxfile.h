@@ -0,0 +1,58 @@
+#ifndef __IDXFILE_H__
+#define __IDXFILE_H__
+
+#include "tipos.h"
+#include "pidx.h"
+#include "lcp.h"
+#include "bwt.h"
+
+/** Index files: the suffix array, LCP array and BWT of a text saved to
+ * disk, so later runs over the same text can skip their construction.
+ *
+ * The file starts with an idxf_header followed by its sections, each
+ * aligned to 8 bytes. The header stores the length and a checksum of the
+ * text, and the widths of uidx and pidx; a file whose header does not
+ * match the current text and build is ignored (and rewritten).
+ * Loaded files are mapped read-only, the arrays point into the mapping.
+ */
+
+#define IDXF_MAGIC "FRSINDEX"
+#define IDXF_VERSION 2
+
+/* Sections */
+enum { IDXF_R, IDXF_H, IDXF_V, IDXF_EX, IDXF_RK, IDXF_BIG, IDXF_BWT, IDXF_NSECT };
+
+typedef struct {
+	char magic[8];
+	uint version;
+	uint width;      /* sizeof(uidx) */
+	uint pwidth;     /* PIDX_BYTES */
+	uint clcp;       /* the LCP array is compressed (V, EX, RK, BIG) or not (H) */
+	uint64 n;
+	uint64 checksum; /* idxf_checksum() of the text */
+	uint64 prim;     /* rank of the rotation 0 */
+	uint64 off[IDXF_NSECT];
+	uint64 len[IDXF_NSECT];
+} idxf_header;
+
+typedef struct {
+	void* map;
+	uint64 size;
+	pidx* r;
+	lcp_array h;
+	left_ctx lc;
+} idxfile;
+
+/** Checksum of the n bytes of s */
+uint64 idxf_checksum(uchar* s, uidx n);
+
+/** Maps the index fn if it exists and matches a text of length n with the
+ * given checksum. Returns FALSE otherwise. */
+bool idxf_open(idxfile* ix, const char* fn, uidx n, uint64 checksum);
+void idxf_close(idxfile* ix);
+
+/** Saves r, h and the left context lc (the BWT) of a text of length n to fn.
+ * Returns TRUE on success. */
+bool idxf_save(const char* fn, uidx n, uint64 checksum, pidx* r, lcp_array* h, left_ctx* lc);
+
+#endif //__IDXFILE_H__
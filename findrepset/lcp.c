@@ -5,10 +5,12 @@
 #include <math.h>
 
 #include "macros.h"
+#include "psort.h"
+#include "emem.h"
 
 
-void lcp(uint n, uchar* s, uint* r, uint* p) {
-	uint h = 0, i, j;
+void lcp(uidx n, uchar* s, uidx* r, uidx* p) {
+	uidx h = 0, i, j;
 	forn(i,n) if (p[i] > 0) {
 		j = r[p[i]-1];
 		while(h < n && s[(i+h)%n] == s[(j+h)%n]) ++h;
@@ -16,3 +18,288 @@ void lcp(uint n, uchar* s, uint* r, uint* p) {
 		if (h > 0) --h;
 	}
 }
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define LCP_WORD_CTZ
+#endif
+
+/* Extends a known common prefix h < mx of rotations i and j, up to mx */
+static inline uidx lcp_extend(uchar* s, uidx n, uidx i, uidx j, uidx h, uidx mx) {
+	uint64 a, b;
+	/* bytes before one of them wraps around */
+	uidx lim = n - (i > j ? i : j);
+	if (lim > mx) lim = mx;
+	while (h + sizeof(uint64) <= lim) {
+		memcpy(&a, s+i+h, sizeof(uint64));
+		memcpy(&b, s+j+h, sizeof(uint64));
+		if (a != b) {
+#ifdef LCP_WORD_CTZ
+			return h + (__builtin_ctzll(a ^ b) >> 3);
+#else
+			while (s[i+h] == s[j+h]) ++h;
+			return h;
+#endif
+		}
+		h += sizeof(uint64);
+	}
+	while (h < lim && s[i+h] == s[j+h]) ++h;
+	if (h < lim || lim == mx) return h;
+	while (h < mx && s[(i+h)%n] == s[(j+h)%n]) ++h;
+	return h;
+}
+
+/* Phi of a rotation that shares maxl characters or more with the one
+ * before it (see lcp_plcp()) */
+#define LCP_TIED PIDX_MAX
+
+typedef struct {
+	uchar* s;
+	pidx *r, *p;
+	uidx* h;
+	uidx n, b, e, mx;
+} lcp_block;
+
+/* PLCP of the positions [b, e) in text order, in place over Phi */
+static void lcp_plcp_block(void* arg, uint th) {
+	lcp_block* bl = (lcp_block*)arg;
+	pidx* p = bl->p;
+	uidx n = bl->n, i, x, l = 0;
+	(void)th;
+	forsn(i, bl->b, bl->e) {
+		x = pidx_get(p, i);
+		if (x == n) { l = 0; pidx_set(p, i, 0); continue; }
+		/* nothing to carry to the next one, which may end a tie */
+		if (x == LCP_TIED) { l = 0; pidx_set(p, i, bl->mx); continue; }
+		l = lcp_extend(bl->s, n, i, x, l, bl->mx);
+		pidx_set(p, i, l);
+		if (l == bl->mx && l < n) l = 0; /* capped, may not carry */
+		else if (l > 0) --l;
+	}
+}
+
+/* h[i] = PLCP[r[i+1]] for the ranks [b, e) */
+static void lcp_perm_block(void* arg, uint th) {
+	lcp_block* bl = (lcp_block*)arg;
+	pidx *r = bl->r, *p = bl->p;
+	uidx *h = bl->h, i;
+	(void)th;
+	forsn(i, bl->b, bl->e) h[i] = pidx_get(p, pidx_get(r, i+1));
+}
+
+/* Splits [0, n) in nb blocks and runs f over them on the pool */
+static void lcp_run_blocks(psort* ps, lcp_block* bl, uidx nb, psort_func* f,
+	uchar* s, pidx* r, pidx* p, uidx* h, uidx n, uidx mx) {
+	uidx i, step = (n + nb - 1) / nb;
+	forn(i, nb) {
+		bl[i].s = s; bl[i].r = r; bl[i].p = p; bl[i].h = h; bl[i].n = n; bl[i].mx = mx;
+		bl[i].b = i * step < n ? i * step : n;
+		bl[i].e = bl[i].b + step < n ? bl[i].b + step : n;
+		psort_job_new(ps, f, &bl[i]);
+	}
+	psort_wait(ps);
+}
+
+void lcp_plcp(uidx n, uchar* s, pidx* r, pidx* p, uint threads, uidx maxl) {
+	uidx i, x, nb;
+	lcp_block* bl;
+	psort ps;
+	if (!n) return;
+	if (!threads) threads = 1;
+
+	/* Phi: the rotation before each one in the order, n for the first.
+	 * With maxl, p[r[i]] < i if r[i] is tied with r[i-1] */
+	pidx_set(p, pidx_get(r, 0), n);
+	if (maxl) forsn(i, 1, n) {
+		x = pidx_get(r, i);
+		pidx_set(p, x, pidx_get(p, x) < i ? LCP_TIED : pidx_get(r, i-1));
+	} else forsn(i, 1, n) pidx_set(p, pidx_get(r, i), pidx_get(r, i-1));
+
+	/* Each block starts from l = 0, so a few per thread are enough */
+	nb = threads > 1 ? 4 * threads : 1;
+	bl = (lcp_block*)pz_malloc(nb * sizeof(lcp_block));
+	psort_init(&ps, threads);
+	lcp_run_blocks(&ps, bl, nb, lcp_plcp_block, s, r, p, NULL, n, maxl && maxl < n ? maxl : n);
+	psort_destroy(&ps);
+	pz_free(bl);
+}
+
+void lcp_phi(uidx n, uchar* s, pidx* r, pidx* p, uidx* h, uint threads, uidx maxl) {
+	uidx nb;
+	lcp_block* bl;
+	psort ps;
+	if (!n) return;
+	if (!threads) threads = 1;
+	lcp_plcp(n, s, r, p, threads, maxl);
+
+	nb = threads > 1 ? 4 * threads : 1;
+	bl = (lcp_block*)pz_malloc(nb * sizeof(lcp_block));
+	psort_init(&ps, threads);
+	lcp_run_blocks(&ps, bl, nb, lcp_perm_block, s, r, p, h, n-1, 0);
+	psort_destroy(&ps);
+	pz_free(bl);
+	h[n-1] = 0;
+}
+
+/*** Blockwise versions ***/
+
+void lcp_plcp_blocks(uidx n, uchar* s, pidx* r, pidx* p, uidx blk, uidx maxl) {
+	uidx b, e, i, k, x, l = 0, mx = maxl && maxl < n ? maxl : n;
+	uidx* phi;
+	if (!n) return;
+	if (blk > n) blk = n;
+	phi = (uidx*)pz_malloc(blk * sizeof(uidx));
+	for(b = 0; b < n; b = e) {
+		e = b + blk < n ? b + blk : n;
+		/* Phi of the positions [b, e) */
+		forn(k, n) if ((x = pidx_get(r, k)) >= b && x < e)
+			phi[x-b] = !k ? n : maxl && pidx_get(p, x) < k ? LCP_TIED : pidx_get(r, k-1);
+		/* l carries over from the previous block, as in text order */
+		forsn(i, b, e) {
+			if (phi[i-b] == n) { l = 0; pidx_set(p, i, 0); continue; }
+			if (phi[i-b] == LCP_TIED) { l = 0; pidx_set(p, i, mx); continue; }
+			l = lcp_extend(s, n, i, phi[i-b], l, mx);
+			pidx_set(p, i, l);
+			if (l == mx && l < n) l = 0;
+			else if (l > 0) --l;
+		}
+	}
+	pz_free(phi);
+}
+
+void lcp_phi_blocks(uidx n, uchar* s, pidx* r, pidx* p, uidx* h, uidx blk, uidx maxl) {
+	uidx b, e, k, x;
+	if (!n) return;
+	lcp_plcp_blocks(n, s, r, p, blk, maxl);
+	/* h[k] = PLCP[r[k+1]], reading the PLCP of one block at a time */
+	for(b = 0; b < n; b = e) {
+		e = b + blk < n ? b + blk : n;
+		forn(k, n-1) if ((x = pidx_get(r, k+1)) >= b && x < e) h[k] = pidx_get(p, x);
+	}
+	h[n-1] = 0;
+}
+
+/*** Compressed LCP array ***/
+
+uidx lcpa_get_big(lcp_array* a, uidx i) {
+	uint64 w = a->ex[i >> 6] & ((1ULL << (i & 63)) - 1);
+#ifdef __GNUC__
+	return a->big[a->rk[i >> 6] + __builtin_popcountll(w)];
+#else
+	uidx c = 0;
+	while (w) { w &= w - 1; ++c; }
+	return a->big[a->rk[i >> 6] + c];
+#endif
+}
+
+void lcpa_plain(lcp_array* a, uidx* h, uidx n) {
+	memset(a, 0, sizeof(lcp_array));
+	a->n = n;
+	a->h = h;
+}
+
+/* Allocates the arrays of a, with room for nx exceptions; v if not NULL
+ * holds the bytes */
+static void lcpa_alloc(lcp_array* a, uidx n, uidx nx, uchar* v) {
+	uidx nw = (n + 63) / 64;
+	memset(a, 0, sizeof(lcp_array));
+	a->n = n;
+	a->v = v ? v : (uchar*)emem_malloc(n ? n : 1);
+	a->ex = (uint64*)emem_malloc((nw ? nw : 1) * sizeof(uint64));
+	a->rk = (uidx*)emem_malloc((nw ? nw : 1) * sizeof(uidx));
+	a->big = nx ? (uidx*)emem_malloc(nx * sizeof(uidx)) : NULL;
+	memset(a->ex, 0, nw * sizeof(uint64));
+}
+
+/* Stores x at i, the entries being set in increasing order; nx counts the
+ * exceptions so far */
+#define lcpa_put(a, i, x, nx) { \
+	if (!((i) & 63)) (a)->rk[(i) >> 6] = nx; \
+	if ((x) >= LCPA_ESC) { \
+		(a)->v[i] = LCPA_ESC; \
+		(a)->ex[(i) >> 6] |= 1ULL << ((i) & 63); \
+		if ((a)->big) (a)->big[nx] = x; \
+		++nx; \
+	} else (a)->v[i] = x; }
+
+void lcpa_from_plcp(lcp_array* a, uidx n, pidx* r, pidx* plcp) {
+	uidx i, x, nx = 0;
+	lcpa_alloc(a, n, 0, NULL);
+	/* bytes and exception bits, with h[i] = plcp[r[i+1]] */
+	forn(i, n) {
+		x = i+1 < n ? pidx_get(plcp, pidx_get(r, i+1)) : 0;
+		lcpa_put(a, i, x, nx);
+	}
+	a->big = (uidx*)emem_malloc((nx ? nx : 1) * sizeof(uidx));
+	nx = 0;
+	forn(i, n) if (a->v[i] == LCPA_ESC) a->big[nx++] = pidx_get(plcp, pidx_get(r, i+1));
+}
+
+/* In text order the PLCP mostly goes down by one along a repeat: those
+ * exceptions are not stored, but taken from the last one stored in their
+ * block of 64 entries (the first exception of a block always is) */
+#define plcp_derived(j, x, y) (((j) & 63) && (y) > LCPA_ESC && (x) == (y)-1)
+
+static inline uidx plcp_get(lcp_array* t, uidx j) {
+	uint64 w;
+	uint b;
+	if (t->v[j] < LCPA_ESC) return t->v[j];
+	/* the exceptions stored up to j in its block, the last one at b */
+	w = t->ex[j >> 6] & ((2ULL << (j & 63)) - 1);
+#ifdef __GNUC__
+	b = 63 - __builtin_clzll(w);
+	return t->big[t->rk[j >> 6] + __builtin_popcountll(w) - 1] - ((j & 63) - b);
+#else
+	uidx c = 0;
+	for(b = 63; !(w >> b & 1); --b);
+	while (w) { w &= w - 1; ++c; }
+	return t->big[t->rk[j >> 6] + c - 1] - ((j & 63) - b);
+#endif
+}
+
+void lcpa_from_plcp_inplace(lcp_array* a, uidx n, pidx* r, pidx* plcp) {
+	uidx i, j, x, y = 0, nx = 0;
+	lcp_array t;
+	forn(j, n) {
+		x = pidx_get(plcp, j);
+		if (x >= LCPA_ESC && !plcp_derived(j, x, y)) ++nx;
+		y = x;
+	}
+	/* the PLCP compressed in text order, its bytes over the first n of
+	 * plcp (the byte j is written once the entry j is read) */
+	lcpa_alloc(&t, n, nx, (uchar*)plcp);
+	nx = y = 0;
+	forn(j, n) {
+		x = pidx_get(plcp, j);
+		if (!(j & 63)) t.rk[j >> 6] = nx;
+		if (x < LCPA_ESC) t.v[j] = x;
+		else {
+			t.v[j] = LCPA_ESC;
+			if (!plcp_derived(j, x, y)) {
+				t.ex[j >> 6] |= 1ULL << (j & 63);
+				t.big[nx++] = x;
+			}
+		}
+		y = x;
+	}
+	t.v = (uchar*)emem_shrink((void*)plcp, n ? n : 1);
+
+	lcpa_alloc(a, n, 0, NULL);
+	nx = 0;
+	forn(i, n) {
+		x = i+1 < n ? plcp_get(&t, pidx_get(r, i+1)) : 0;
+		lcpa_put(a, i, x, nx);
+	}
+	a->big = (uidx*)emem_malloc((nx ? nx : 1) * sizeof(uidx));
+	nx = 0;
+	forn(i, n) if (a->v[i] == LCPA_ESC) a->big[nx++] = plcp_get(&t, pidx_get(r, i+1));
+	lcpa_free(&t);
+}
+
+void lcpa_free(lcp_array* a) {
+	if (a->h) emem_free(a->h);
+	if (a->v) emem_free(a->v);
+	if (a->ex) emem_free(a->ex);
+	if (a->rk) emem_free(a->rk);
+	if (a->big) emem_free(a->big);
+	memset(a, 0, sizeof(lcp_array));
+}
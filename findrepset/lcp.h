@@ -2,13 +2,90 @@
 #define __LCP_H__
 
 #include "tipos.h"
+#include "pidx.h"
 
-/* Takes as input 2 uint arrays of length at least n (p and r)
+/* Takes as input 2 uidx arrays of length at least n (p and r)
  * and the original string of length n (s)
  * r should be the lexicographical order of all rotations of s
  * p should be the inverse permutation of r
  * the output is given on r
  */
-void lcp(uint n, uchar* s, uint* r, uint* p);
+void lcp(uidx n, uchar* s, uidx* r, uidx* p);
+
+/* LCP array as read by the enumerators (mrs, mmrs, mcl, ...).
+ * It is either a plain uidx array (h != NULL) or a compressed one: a byte
+ * per entry, where LCPA_ESC marks an exception whose value is kept in big.
+ * The exceptions are found with a bitvector and the count of exceptions
+ * before each block of 64 entries.
+ * Read it with lcpa_get().
+ */
+#define LCPA_ESC 255
+
+typedef struct {
+	uidx n;
+	uidx* h;      /* plain array, NULL if compressed */
+	uchar* v;     /* min(h[i], LCPA_ESC) */
+	uint64* ex;   /* bit i is set iff h[i] >= LCPA_ESC */
+	uidx* rk;     /* exceptions before each block of 64 entries */
+	uidx* big;    /* values of the exceptions, in order */
+} lcp_array;
+
+/* An exception of the compressed array, for lcpa_get() */
+uidx lcpa_get_big(lcp_array* a, uidx i);
+
+#define lcpa_get(a, i) ((a)->h ? (a)->h[i] : \
+	((a)->v[i] < LCPA_ESC ? (uidx)(a)->v[i] : lcpa_get_big(a, i)))
+
+/* Wraps the plain array h of length n, which becomes owned by a */
+void lcpa_plain(lcp_array* a, uidx* h, uidx n);
+
+/* Builds a compressed array from the PLCP left by lcp_plcp() */
+void lcpa_from_plcp(lcp_array* a, uidx n, pidx* r, pidx* plcp);
+
+/* Same as lcpa_from_plcp(), with plcp an emem block (see emem.h) that is
+ * reused and freed: its first n bytes keep the PLCP compressed in text
+ * order while a is built, where an exception one less than the one before
+ * it is not stored. The peak is then plcp and r plus a few bits per entry,
+ * instead of plcp, r and a. */
+void lcpa_from_plcp_inplace(lcp_array* a, uidx n, pidx* r, pidx* plcp);
+
+/* Frees the memory of a (including a plain h) */
+void lcpa_free(lcp_array* a);
+
+/* Leaves in p the permuted LCP (PLCP): p[j] is the lcp of the rotation j
+ * and the one before it in r (0 for r[0]).
+ * r is the order of the rotations of s and is left unchanged. Both are
+ * packed (see pidx.h): the PLCP is built over them in text order and
+ * their few random accesses cost little more with 40-bit entries.
+ * The text is split in blocks computed by "threads" threads.
+ * If maxl is not 0 the values are capped at maxl, and r only needs to be
+ * ordered by the first t >= maxl characters of the rotations: p must then
+ * come with the first rank of the group of each rotation, as bwt() leaves
+ * it (see maxdepth in bwt_opts), or with the inverse of r. The rotations tied
+ * with the one before them get maxl without being compared, and a capped
+ * value is not carried to the next rotation (r may be ordered deeper in
+ * some places than in others), so the time is bounded by n times maxl
+ * instead of n times the largest lcp.
+ */
+void lcp_plcp(uidx n, uchar* s, pidx* r, pidx* p, uint threads, uidx maxl);
+
+/* Same output as lcp(), computed with the permuted LCP (PLCP) through
+ * the Phi array, in text order and comparing a word at a time.
+ * r is the order of the rotations of s and is left unchanged.
+ * p is working memory of n entries and is destroyed (it does not need to
+ * hold the inverse of r, but see maxl in lcp_plcp()).
+ * The output is given on h: h[i] is the lcp of rotations r[i] and r[i+1];
+ * h[n-1] is set to 0.
+ * See lcp_plcp().
+ */
+void lcp_phi(uidx n, uchar* s, pidx* r, pidx* p, uidx* h, uint threads, uidx maxl);
+
+/* Versions of lcp_plcp() and lcp_phi() for arrays that do not fit in RAM
+ * (see emem.h). The text is processed in blocks of blk positions, whose
+ * Phi is kept in memory. Each block reads r and writes p and h
+ * sequentially, so p, r and h are only accessed in increasing order.
+ */
+void lcp_plcp_blocks(uidx n, uchar* s, pidx* r, pidx* p, uidx blk, uidx maxl);
+void lcp_phi_blocks(uidx n, uchar* s, pidx* r, pidx* p, uidx* h, uidx blk, uidx maxl);
 
 #endif //__LCP_H__
@@ -48,4 +48,8 @@ void _pz_free(void *ptr, char *file, int line);
 #define pz_free free
 #endif
 
+/* Grows (or shrinks) p to n bytes; exits with a message if it fails */
+void *_pz_realloc(void *ptr, size_t n, char *file, int line);
+#define pz_realloc(p, n)	_pz_realloc(p, n, __FILE__, __LINE__)
+
 #endif // __MACROS_C__
@@ -5,37 +5,40 @@
 
 #include "macros.h"
 #include "output_callbacks.h"
+#include "psort.h"
 
 //static __thread uint* data;
 #define DATA_VAL(x) data[*(x)]
 
-void mmrs(uchar* s, uint n, uint* r, uint* h, uint ml,
-		 output_callback out, void* data) {
-	uint i,j,k,up = 0;
-	uchar prev;
-	uint alph_size = 1 << sizeof(uchar) * 8;
-	bool* alph = (bool*)pz_malloc(alph_size * sizeof(bool));
+/* Below this size the scan is not split */
+#define MMRS_MIN_PAR (1 << 16)
+
+/* Scans the steps [b, e) of h, starting with the given up */
+static void mmrs_scan(left_ctx* lc, lcp_array* h, uidx ml, uidx b, uidx e,
+		 uidx up, bool* alph, output_callback out, void* data) {
+	uidx i,j,k;
+	uidx hi, hp = lcpa_get(h, b-1);
+	uidx prev;
 	bool coll;
-//	h[n-1] = 0;
-	memset(alph, 0, alph_size * sizeof(bool));
 
-	forsn(i, 1, n-1) {
+	for(i = b; i < e; ++i, hp = hi) {
+		hi = lcpa_get(h, i);
 		
 		/* mark the last step up */
-		if (h[i] > h[i-1]) {
+		if (hi > hp) {
 			up = i;
 			continue;
 		}
 
-		if (h[i] == h[i-1]) continue;
+		if (hi == hp) continue;
 		
 		/* now we're going downhill */
-		if (up != -1 && h[i-1] >= ml){
+		if (up != -1 && hp >= ml){
 			coll = 0;
 
 			forsn(j, up, i+1){
-				if (r[j] > 0){
-					prev = s[r[j]-1];
+				if (lctx_has(lc, j)){
+					prev = lctx_at(lc, j);
 					if (alph[prev]){
 						coll = 1;
 						break;
@@ -43,12 +46,92 @@ void mmrs(uchar* s, uint n, uint* r, uint* h, uint ml,
 					alph[prev] = 1;
 				}
 			}
-			if (coll == 0) out(h[up], up , i-up+1, data);
-			forsn(k, up, j) if (r[k] > 0) alph[s[r[k]-1]] = 0;
+			if (coll == 0) out(lcpa_get(h, up), up , i-up+1, data);
+			forsn(k, up, j) if (lctx_has(lc, k)) alph[lctx_at(lc, k)] = 0;
 			/* warning: setting an unsigned int with a negative value */
 			up = -1; 
 		}
 	}
-	pz_free(alph);
 }
 
+/*** Parallel scan ***/
+
+/* The steps [b, e) of a chunk, and the triples it found */
+typedef struct {
+	left_ctx* lc;
+	lcp_array* h;
+	uidx ml, b, e;
+	bool** alph;
+	uidx *o, on, osz;
+} mmrs_chunk;
+
+static void mmrs_chunk_out(uidx l, uidx i, uidx n, void* data) {
+	mmrs_chunk* ch = (mmrs_chunk*)data;
+	if (ch->on + 3 > ch->osz) {
+		ch->osz = ch->osz ? 2 * ch->osz : 3 * 1024;
+		ch->o = (uidx*)pz_realloc(ch->o, ch->osz * sizeof(uidx));
+	}
+	ch->o[ch->on++] = l;
+	ch->o[ch->on++] = i;
+	ch->o[ch->on++] = n;
+}
+
+static void mmrs_chunk_run(void* arg, uint th) {
+	mmrs_chunk* ch = (mmrs_chunk*)arg;
+	/* Only the first chunk starts at a step up (the virtual h[-1]) */
+	mmrs_scan(ch->lc, ch->h, ch->ml, ch->b, ch->e, ch->b == 1 ? 0 : -1,
+		ch->alph[th], mmrs_chunk_out, ch);
+}
+
+void mmrs(left_ctx* lc, uidx n, lcp_array* h, uidx ml, uint threads,
+		 output_callback out, void* data) {
+	uidx alph_size = lc->lid ? lc->nid : 1 << sizeof(uchar) * 8;
+	uidx i, j, nb, c, step;
+	bool** alph;
+	mmrs_chunk* ch;
+	psort ps;
+	if (!threads) threads = 1;
+//	h[n-1] = 0;
+	if (n < 3) return;
+	if (threads == 1 || n < MMRS_MIN_PAR) {
+		alph = (bool**)pz_malloc(sizeof(bool*));
+		alph[0] = (bool*)pz_malloc(alph_size * sizeof(bool));
+		memset(alph[0], 0, alph_size * sizeof(bool));
+		mmrs_scan(lc, h, ml, 1, n-1, 0, alph[0], out, data);
+		pz_free(alph[0]);
+		pz_free(alph);
+		return;
+	}
+
+	/* No reported interval contains a step c with h[c] < ml, so the chunks
+	 * start right after one of them */
+	nb = 4 * threads;
+	step = (n - 2 + nb - 1) / nb;
+	ch = (mmrs_chunk*)pz_malloc(nb * sizeof(mmrs_chunk));
+	memset(ch, 0, nb * sizeof(mmrs_chunk));
+	alph = (bool**)pz_malloc(threads * sizeof(bool*));
+	forn(i, threads) {
+		alph[i] = (bool*)pz_malloc(alph_size * sizeof(bool));
+		memset(alph[i], 0, alph_size * sizeof(bool));
+	}
+	c = 1;
+	forn(i, nb) {
+		ch[i].lc = lc; ch[i].h = h; ch[i].ml = ml; ch[i].alph = alph;
+		ch[i].b = c;
+		c = c + step < n-1 ? c + step : n-1;
+		while (c < n-1 && lcpa_get(h, c-1) >= ml) ++c;
+		ch[i].e = c;
+	}
+	psort_init(&ps, threads);
+	forn(i, nb) if (ch[i].b < ch[i].e) psort_job_new(&ps, mmrs_chunk_run, &ch[i]);
+	psort_wait(&ps);
+	psort_destroy(&ps);
+
+	forn(i, nb) {
+		for(j = 0; j < ch[i].on; j += 3) out(ch[i].o[j], ch[i].o[j+1], ch[i].o[j+2], data);
+		free(ch[i].o);
+	}
+	forn(i, threads) pz_free(alph[i]);
+	pz_free(alph);
+	pz_free(ch);
+}
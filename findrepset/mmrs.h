@@ -4,18 +4,24 @@
 #include "tipos.h"
 #include <stdio.h>
 #include "output_callbacks.h"
+#include "lcp.h"
+#include "bwt.h"
 
 /**
  * Calculates the maximal maximal repeated substrings of the input string s of
- * size n.  r, and h must be of size n.
- * r must contain the starting point of all suffixes of s in lexicographical
- * order. h[i] must contain the length of the longest common prefix between
+ * size n.  lc is the left context of the rotations of s (see bwt.h), and
+ * h must be of size n.
+ * With r the starting point of all suffixes of s in lexicographical order,
+ * h (see lcp.h) must contain at i the length of the longest common prefix between
  * s[r[i]]s[r[i]+1]...s[n] and s[r[i+1]]s[r[i+1]+1]...s[n]. 
  * ml is the minimum length a substring has to have to be considered
+ * With threads > 1 the scan is split at the steps where h is below ml and
+ * the pieces run in parallel; out is still called from the calling thread,
+ * in the same order.
  * The output is given by calling out with the extra parameter data 
  * (see above).
  */
-void mmrs(uchar* s, uint n, uint* r, uint* h, uint ml,
+void mmrs(left_ctx* lc, uidx n, lcp_array* h, uidx ml, uint threads,
 		 output_callback out, void* data);
 
 #endif // __MMRS_H__
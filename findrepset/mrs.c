@@ -3,62 +3,115 @@
 #include <stdlib.h>
 
 #include "bittree.h"
-#include "sorters.h"
+#include "radix.h"
 
 #include "macros.h"
 #include "output_callbacks.h"
+#include "emem.h"
 
-static __thread uint* data;
-#define DATA_VAL(x) data[*(x)]
-_def_qsort3(qsort_data, uint, uint, DATA_VAL, <)
-
-void sort(uint n, uint* _data, uint* ind) {
-	uint i;
-	data = _data;
-	forn(i,n) ind[i] = i;
-	qsort_data(ind, ind+n);
+static uidx mrs_lcp_key(void* h, uidx i) {
+	return lcpa_get((lcp_array*)h, i);
 }
 
-void mrs(uchar* s, uint n, uint* r, uint* h, uint* p, uint ml,
+void mrs(left_ctx* lc, uidx n, pidx* r, lcp_array* h, uidx* p, uidx ml, uint threads,
 		 output_callback out, void* data) {
 	
-	uint i,ii,j,k,n1=n+1;
+	uidx i,ii,j,k,rj,rk,hi,mh = 0,n1=n+1;
 	/*TODO: trick to use half the memory for ind*/
-	uint* ind = (uint*)pz_malloc((n-1) * sizeof(uint));
+	uidx* ind = (uidx*)emem_malloc((n-1) * sizeof(uidx));
 	bittree* tree = bittree_malloc(n1);
 	bittree_clear(tree, n1);
 	bittree_preset(tree,n1,0);
 	bittree_preset(tree,n1,n);
-	forn(i,n-1) if (h[i] < ml) bittree_preset(tree,n1,i+1);
+	forn(i,n-1) {
+		if ((hi = lcpa_get(h, i)) < ml) bittree_preset(tree,n1,i+1);
+		else if (hi > mh) mh = hi;
+	}
 	bittree_endset(tree,n1);
 
-	sort(n-1, h, p);
-//	fprintf(stderr, "mrs: sort end\n");
-//	DBGun(p, n);
-
-	forn(i,n-1) ind[i] = p[i];
-	forn(i,n) p[r[i]] = i;
+	/* the steps by lcp; the ones below ml are skipped, in any order */
+	radix_count(ind, n-1, ml, mh, mrs_lcp_key, h, threads);
+	forn(i,n) p[pidx_get(r, i)] = i;
 
 	forn(ii,n-1) {
 		i = ind[ii];
 		/*showtree(tree, n1);
 		printf("%d (%d)\n", i, h[i]);*/
-		if (h[i] < ml) continue;
+		hi = lcpa_get(h, i);
+		if (hi < ml) continue;
 		j = bittree_max_less_than(tree, n1, i+1);
 
-		if (j > 0 && h[j-1]==h[i]) {
+		if (j > 0 && lcpa_get(h, j-1)==hi) {
 			bittree_set(tree, n1, i+1);
 			continue;
 		}
 		k = bittree_min_greater_than(tree, n1, i+1) - 1;
 		bittree_set(tree, n1, i+1);
 
-		if (k < n-1 && h[k]==h[i]) continue;
-		if (r[j] > 0 && r[k] > 0 && s[r[j]-1] == s[r[k]-1]
-			&& p[r[k]-1]-p[r[j]-1]==k-j) continue;
-		out(h[i], j , k-j+1, data);
+		if (k < n-1 && lcpa_get(h, k)==hi) continue;
+		if (lctx_has(lc, j) && lctx_has(lc, k) && lctx_at(lc, j) == lctx_at(lc, k)) {
+			rj = pidx_get(r, j); rk = pidx_get(r, k);
+			if (p[rk-1]-p[rj-1]==k-j) continue;
+		}
+		out(hi, j , k-j+1, data);
 	}
 	bittree_free(tree, n1);
-	pz_free(ind);
+	emem_free(ind);
 }
 
+
+/* Left context of an interval: the character (or segment name) preceding
+ * all its suffixes, LC_MIXED if they differ (or one of them is the whole
+ * string) */
+#define LC_EMPTY ((uidx)-1)
+#define LC_MIXED ((uidx)-2)
+#define lc_merge(a, b) ((a) == LC_EMPTY ? (b) : (a) == (b) ? (a) : LC_MIXED)
+
+typedef struct {
+	uidx l, lb, c;
+} smrs_node;
+
+void smrs(left_ctx* lc, uidx n, lcp_array* h, uidx ml,
+		  output_callback out, void* data) {
+	uidx i, l = 0, lb, c, top = 0, sz = 1024;
+	bool root = FALSE;
+	smrs_node* st;
+	if (n < 2) return;
+	st = (smrs_node*)pz_malloc(sz * sizeof(smrs_node));
+	st[0].l = 0; st[0].lb = 0; st[0].c = LC_EMPTY;
+
+	/* Bottom-up traversal of the lcp-intervals. Step i handles the boundary
+	 * between i-1 and i; c is the left context of the child (leaf i-1 or
+	 * the last closed interval) being attached to its parent.
+	 * lcp values below ml are taken as 0, which keeps the intervals of
+	 * lcp >= ml unchanged. */
+	forsn(i, 1, n+1) {
+		c = lctx_has(lc, i-1) ? lctx_at(lc, i-1) : LC_MIXED;
+		lb = i-1;
+		if (i < n) {
+			l = lcpa_get(h, i-1);
+			if (l < ml) l = 0;
+		}
+		while (top && (i == n || l < st[top].l)) {
+			st[top].c = lc_merge(st[top].c, c);
+			if (st[top].c == LC_MIXED) out(st[top].l, st[top].lb, i-st[top].lb, data);
+			lb = st[top].lb;
+			c = st[top--].c;
+		}
+		if (i == n) {
+			st[0].c = lc_merge(st[0].c, c);
+		} else if (l > st[top].l) {
+			if (++top == sz) {
+				sz *= 2;
+				st = (smrs_node*)pz_realloc(st, sz * sizeof(smrs_node));
+			}
+			st[top].l = l; st[top].lb = lb; st[top].c = c;
+		} else {
+			st[top].c = lc_merge(st[top].c, c);
+			if (!top) root = TRUE;
+		}
+	}
+	/* [0, n-1] is an lcp-interval only if some boundary has lcp 0 */
+	if (root && !ml && st[0].c == LC_MIXED) out(0, 0, n, data);
+	pz_free(st);
+}
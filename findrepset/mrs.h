@@ -4,19 +4,36 @@
 #include "tipos.h"
 #include <stdio.h>
 #include "output_callbacks.h"
+#include "lcp.h"
+#include "bwt.h"
 
 /**
  * Calculates the maximal repeated substrings of the input string s of size n.
+ * lc is the left context of the rotations of s (see bwt.h).
  * r, h and p must be of size n.
  * r must contain the starting point of all suffixes of s in lexicographical
- * order. h[i] must contain the length of the longest common prefix between
+ * order. h (see lcp.h) must contain at i the length of the longest common prefix between
  * s[r[i]]s[r[i]+1]...s[n] and s[r[i+1]]s[r[i+1]+1]...s[n]. p may contain
  * anything, and will be returned with the inverse permutation of r.
  * ml is the minimum length a substring has to have to be considered
+ * The steps of h are ordered with a counting sort (see radix.h), run by
+ * up to threads threads, so the repeats come by increasing length (and
+ * by position in r for the same length).
  * The output is given by calling out with the extra parameter data 
  * (see above).
  */
-void mrs(uchar* s, uint n, uint* r, uint* h, uint* p, uint ml,
+void mrs(left_ctx* lc, uidx n, pidx* r, lcp_array* h, uidx* p, uidx ml, uint threads,
 		 output_callback out, void* data);
 
+/**
+ * Same repeats as mrs(), in linear time, but in another order: traverses
+ * the lcp-intervals bottom-up with a stack, keeping for each one whether
+ * all its suffixes are preceded by the same character. The repeats come
+ * by the end of their interval in r, and a repeat nested in another
+ * (longer, on fewer suffixes) before it; not by increasing length.
+ * Needs no r, no p and no sort of h.
+ */
+void smrs(left_ctx* lc, uidx n, lcp_array* h, uidx ml,
+		  output_callback out, void* data);
+
 #endif // __MRS_H__
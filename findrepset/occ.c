@@ -0,0 +1,42 @@
+#include "occ.h"
+#include "macros.h"
+#include "emem.h"
+
+#include <string.h>
+
+void occ_build(occ_index* o, left_ctx* lc, uidx n) {
+	uidx i, nb = n / OCC_BLOCK + 1, ns = n / OCC_SUPER + 1;
+	uidx cnt[256], sup[256];
+	uint x;
+	o->n = n;
+	o->lc = *lc;
+	o->sb = (uidx*)emem_malloc(ns * 256 * sizeof(uidx));
+	o->b = (ushort*)emem_malloc(nb * 256 * sizeof(ushort));
+	memset(cnt, 0, sizeof(cnt));
+	forn(i, n+1) {
+		if (!(i % OCC_SUPER)) {
+			memcpy(sup, cnt, sizeof(cnt));
+			memcpy(o->sb + i / OCC_SUPER * 256, cnt, sizeof(cnt));
+		}
+		if (!(i % OCC_BLOCK)) forn(x, 256) o->b[i / OCC_BLOCK * 256 + x] = cnt[x] - sup[x];
+		if (i < n && i != lc->prim) cnt[lc->bw[i]]++;
+	}
+
+	/* The text has the same characters as its BWT, the one at prim included */
+	cnt[lc->bw[lc->prim]]++;
+	o->c[0] = 0;
+	forn(x, 256) o->c[x+1] = o->c[x] + cnt[x];
+}
+
+void occ_free(occ_index* o) {
+	emem_free(o->b);
+	emem_free(o->sb);
+}
+
+uidx occ_rank(occ_index* o, uchar c, uidx g) {
+	uidx j, k = o->sb[g / OCC_SUPER * 256 + c] + o->b[g / OCC_BLOCK * 256 + c];
+	uchar* bw = o->lc.bw;
+	for(j = g - g % OCC_BLOCK; j < g; ++j) k += bw[j] == c;
+	if (o->lc.prim >= g - g % OCC_BLOCK && o->lc.prim < g && bw[o->lc.prim] == c) k--;
+	return k;
+}
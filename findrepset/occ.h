@@ -0,0 +1,32 @@
+#ifndef __OCC_H__
+#define __OCC_H__
+
+#include "tipos.h"
+#include "bwt.h"
+
+/** C and Occ tables over the BWT of a text, for backward search.
+ *
+ * occ_rank(o, c, g) is the number of rotations among the first g in
+ * rotation order that are preceded by c, leaving out the rotation 0 (it
+ * has no previous suffix). Counts are sampled every OCC_BLOCK entries
+ * (16 bits, relative to a superblock of OCC_SUPER entries), so the table
+ * takes about 2 bytes per text character.
+ */
+
+#define OCC_BLOCK 256
+#define OCC_SUPER 65536
+
+typedef struct {
+	uidx n;
+	left_ctx lc;
+	uidx c[257];  /* c[x]: number of characters smaller than x */
+	uidx* sb;     /* counts up to each superblock */
+	ushort* b;    /* counts from the superblock up to each block */
+} occ_index;
+
+void occ_build(occ_index* o, left_ctx* lc, uidx n);
+void occ_free(occ_index* o);
+
+uidx occ_rank(occ_index* o, uchar c, uidx g);
+
+#endif //__OCC_H__
@@ -4,58 +4,121 @@
 #include "macros.h"
 #include "output_callbacks.h"
 #include "enc.h"
+#include "sorters.h"
 
-int output_file(uint l, uint i, uint n, void* vout) {
+#include <string.h>
+
+int output_file(uidx l, uidx i, uidx n, void* vout) {
 	FILE* out = (FILE*)vout;
 	int wt = 0;
-	wt += fwrite(&l, sizeof(uint), 1, out);
-	wt += fwrite(&i, sizeof(uint), 1, out);
-	wt += fwrite(&n, sizeof(uint), 1, out);
+	wt += fwrite(&l, sizeof(uidx), 1, out);
+	wt += fwrite(&i, sizeof(uidx), 1, out);
+	wt += fwrite(&n, sizeof(uidx), 1, out);
 	return wt;
 }
 
-void output_file_text(uint l, uint i, uint n, void* vout) {
+void output_file_text(uidx l, uidx i, uidx n, void* vout) {
 	FILE* out = (FILE*)vout;
-	fprintf(out, "%u %u %u\n", l, i, n);
+	fprintf(out, UIDX_FMT" "UIDX_FMT" "UIDX_FMT"\n", l, i, n);
 }
 
-void output_readable(uint l, uint i, uint n, void* vout) {
-	uint j;
+void output_readable(uidx l, uidx i, uidx n, void* vout) {
+	uidx j;
 	output_readable_data* out = (output_readable_data*)vout;
-	forn(j,l) fprintf(out->fp,"%c",out->s[out->r[i]+j]);
-	fprintf(out->fp," (%u)\n  ", l);
-	forn(j,n) fprintf(out->fp, " %d", out->r[i+j]);
+	forn(j,l) fprintf(out->fp,"%c",out->s[pidx_get(out->r, i)+j]);
+	fprintf(out->fp," ("UIDX_FMT")\n  ", l);
+	forn(j,n) fprintf(out->fp, " "UIDX_FMT, pidx_get(out->r, i+j));
 	fprintf(out->fp,"\n");
 }
 
-void output_findmaxrep(uint l, uint i, uint n, void* vout) {
-	uint j;
+/* Copies the string literal str at b */
+#define OW_LIT(b, str) { memcpy(b, str, sizeof(str)-1); b += sizeof(str)-1; }
+
+void output_findmaxrep(uidx l, uidx i, uidx n, void* vout) {
+	uidx j;
+	uchar* b;
+	output_readable_data* out = (output_readable_data*)vout;
+	ow* w = out->w;
+	b = ow_reserve(w, 128);
+	OW_LIT(b, "Repeat size: ");
+	b = ow_utoa(b, l);
+	OW_LIT(b, "\nNumber of occurrences: ");
+	b = ow_utoa(b, n);
+	OW_LIT(b, "\nRepeat subtext: ");
+	ow_commit(w, b);
+	ow_write(w, out->s + pidx_get(out->r, i), l);
+	b = ow_reserve(w, 128);
+	OW_LIT(b, "\nSuffix array interval of this repeat: [");
+	b = ow_utoa(b, i);
+	OW_LIT(b, ", ");
+	b = ow_utoa(b, i+n-1);
+	OW_LIT(b, "]\nText positions of this repeat: ");
+	ow_commit(w, b);
+	forn(j,n) {
+		b = ow_reserve(w, 24);
+		*b++ = ' ';
+		b = ow_utoa(b, pidx_get(out->r, i+j));
+		ow_commit(w, b);
+	}
+	ow_puts(w, "\n\n");
+	out->a++;	// repeat counter
+}
+
+static inline uchar* outb_varint(uchar* b, uidx x) {
+	while (x >= 0x80) { *b++ = (uchar)(x | 0x80); x >>= 7; }
+	*b++ = (uchar)x;
+	return b;
+}
+
+#define POS_VAL(x) (*(x))
+static _def_qsort3(outb_sort_pos, uidx, uidx, POS_VAL, <)
+
+void output_binary_header(ow* w) {
+	uchar v = OUTB_VERSION;
+	ow_puts(w, OUTB_MAGIC);
+	ow_write(w, &v, 1);
+}
+
+void output_binary(uidx l, uidx i, uidx n, void* vout) {
+	uidx j;
+	uchar* b;
 	output_readable_data* out = (output_readable_data*)vout;
-	fprintf(out->fp,"Repeat size: %u\n", l);
-	fprintf(out->fp, "Number of occurrences: %u\n", n);
-	fprintf(out->fp, "Repeat subtext: ");
-	forn(j,l) fputc(out->s[out->r[i]+j], out->fp);
-	fprintf(out->fp, "\nSuffix array interval of this repeat: [%d, %d]\n", i, i+n-1);
-	fprintf(out->fp, "Text positions of this repeat: ");
-	forn(j,n) fprintf(out->fp, " %d", out->r[i+j]);
-	fputs("\n\n", out->fp);
+	ow* w = out->w;
+	if (n > out->pos_size) {
+		pz_free(out->pos);
+		out->pos_size = n > 2 * out->pos_size ? n : 2 * out->pos_size;
+		out->pos = (uidx*)pz_malloc(out->pos_size * sizeof(uidx));
+	}
+	forn(j,n) out->pos[j] = pidx_get(out->r, i+j);
+	outb_sort_pos(out->pos, out->pos+n);
+	/* a varint takes at most 10 bytes */
+	b = ow_reserve(w, 30);
+	b = outb_varint(b, l);
+	b = outb_varint(b, i);
+	b = outb_varint(b, n);
+	ow_commit(w, b);
+	forn(j,n) {
+		b = ow_reserve(w, 10);
+		b = outb_varint(b, j ? out->pos[j] - out->pos[j-1] : out->pos[0]);
+		ow_commit(w, b);
+	}
 	out->a++;	// repeat counter
 }
 
-void output_readable_po(uint l, uint i, uint n, void* vout) {
-	uint j;
+void output_readable_po(uidx l, uidx i, uidx n, void* vout) {
+	uidx j;
 	output_readable_data* out = (output_readable_data*)vout;
-	forn(j,l) fprintf(out->fp,"%c",out->s[out->r[i]+j]);
+	forn(j,l) fprintf(out->fp,"%c",out->s[pidx_get(out->r, i)+j]);
 	fprintf(out->fp,"\n");
 }
 
-void output_readable_trac(uint l, uint i, uint n, void *vout) {
-	uint j;
+void output_readable_trac(uidx l, uidx i, uidx n, void *vout) {
+	uidx j;
 	output_readable_data* out = (output_readable_data*)vout;
-	forn(j, l) fprintf(out->fp, "%c", out->s[out->r[i] + j]);
-	fprintf(out->fp," #%u (%u)\n ", n, l);
+	forn(j, l) fprintf(out->fp, "%c", out->s[pidx_get(out->r, i) + j]);
+	fprintf(out->fp," #"UIDX_FMT" ("UIDX_FMT")\n ", n, l);
 	forn(j, n) {
-		uint pos = out->r[i + j];
+		uint pos = pidx_get(out->r, i + j);
 		if (!out->trac_size) {
 			fprintf(out->fp, " <%d", pos);
 		} else {
@@ -69,5 +132,5 @@ void output_readable_trac(uint l, uint i, uint n, void *vout) {
 	fprintf(out->fp,"\n");
 }
 
-void output_nothing(uint l, uint i, uint n, void* out) {
+void output_nothing(uidx l, uidx i, uidx n, void* out) {
 }
@@ -2,6 +2,8 @@
 #define __OUTPUT_CALLBACKS_H__
 
 #include "tipos.h"
+#include "pidx.h"
+#include "ow.h"
 #include <stdio.h>
 
 /**
@@ -11,22 +13,22 @@
  * The third parameter is the number of such repetitions. The fourth is just
  * an echo of the void* passed to the function.
  */
-typedef void(output_callback)(uint, uint, uint, void*);
+typedef void(output_callback)(uidx, uidx, uidx, void*);
 
 /**
  * A useful output_callback to throw the output on a file pointed by the
  * extra data.
  */
-int output_file(uint l, uint i, uint n, void* out);
+int output_file(uidx l, uidx i, uidx n, void* out);
 
 /**
  * Similar to the above, but writes the file in text mode (easier to read by
  * a human)
  */
-void output_file_text(uint l, uint i, uint n, void* out);
+void output_file_text(uidx l, uidx i, uidx n, void* out);
 
 struct output_readable_data_struct {
-	uint* r;
+	pidx* r;
 	uchar* s;
 	int a;
 	FILE* fp;
@@ -35,29 +37,52 @@ struct output_readable_data_struct {
 	uint *trac_buf;
 	uint trac_size;
 	uint trac_middle;
+
+	/* output_findmaxrep() and output_binary() write here instead of fp */
+	ow *w;
+
+	/* Scratch for output_binary(), NULL at first; pz_free() it at the end */
+	uidx *pos;
+	uidx pos_size;
 };
 
 typedef struct output_readable_data_struct output_readable_data;
 
-void output_readable(uint l, uint i, uint n, void* out);
+void output_readable(uidx l, uidx i, uidx n, void* out);
 
 /**
  * Similar to the above, but prints the patterns without further information
  */
-void output_readable_po(uint l, uint i, uint n, void* out);
+void output_readable_po(uidx l, uidx i, uidx n, void* out);
 
 /**
  * Prints all the information using the same format as the findmaxrep tool
  */
-void output_findmaxrep(uint l, uint i, uint n, void* vout);
+void output_findmaxrep(uidx l, uidx i, uidx n, void* vout);
+
+/**
+ * Binary repeat stream, read by the postprocessor together with the text.
+ * output_binary_header() writes the header once, then output_binary() one
+ * record per repeat:
+ *   header: the 7 bytes OUTB_MAGIC and one byte OUTB_VERSION
+ *   record: l, i, n, then the n text positions sorted, the first one as is
+ *           and the rest as differences with the previous one
+ * All numbers are unsigned LEB128 varints (7 bits per byte, low first).
+ * The repeated text is not stored, it is s at any of the positions.
+ */
+#define OUTB_MAGIC "FRSREPB"
+#define OUTB_VERSION 1
+
+void output_binary_header(ow* w);
+void output_binary(uidx l, uidx i, uidx n, void* vout);
 
 /* Also track positions */
-void output_readable_trac(uint l, uint i, uint n, void* out);
+void output_readable_trac(uidx l, uidx i, uidx n, void* out);
 
 
 /**
  * Do nothing
  */
-void output_nothing(uint l, uint i, uint n, void* out);
+void output_nothing(uidx l, uidx i, uidx n, void* out);
 
 #endif // __OUTPUT_CALLBACKS_H__
@@ -0,0 +1,100 @@
+#include "ow.h"
+#include "macros.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void* ow_thread(void* arg) {
+	ow* w = (ow*)arg;
+	uchar* b;
+	size_t k;
+	pthread_mutex_lock(&w->mx);
+	while (TRUE) {
+		while (!w->qc && !w->quit) pthread_cond_wait(&w->cv_full, &w->mx);
+		if (!w->qc) break;
+		b = w->q[w->qb];
+		k = w->qn[w->qb];
+		w->qb = (w->qb + 1) % w->nb;
+		w->qc--;
+		pthread_mutex_unlock(&w->mx);
+		if (!w->err && fwrite(b, 1, k, w->fp) != k) w->err = TRUE;
+		pthread_mutex_lock(&w->mx);
+		w->fr[w->nfr++] = b;
+		pthread_cond_signal(&w->cv_free);
+	}
+	pthread_mutex_unlock(&w->mx);
+	return NULL;
+}
+
+void ow_init(ow* w, FILE* fp, size_t bsz, uint nb) {
+	uint i;
+	if (nb < 2) nb = 2;
+	memset(w, 0, sizeof(ow));
+	w->fp = fp;
+	w->bsz = bsz;
+	w->nb = nb;
+	w->q = (uchar**)pz_malloc(nb * sizeof(uchar*));
+	w->qn = (size_t*)pz_malloc(nb * sizeof(size_t));
+	w->fr = (uchar**)pz_malloc(nb * sizeof(uchar*));
+	forn(i, nb) w->fr[i] = (uchar*)pz_malloc(bsz);
+	w->nfr = nb - 1;
+	w->cur = w->fr[nb - 1];
+	pthread_mutex_init(&w->mx, NULL);
+	pthread_cond_init(&w->cv_full, NULL);
+	pthread_cond_init(&w->cv_free, NULL);
+	pthread_create(&w->th, NULL, ow_thread, w);
+}
+
+void ow_next(ow* w) {
+	pthread_mutex_lock(&w->mx);
+	if (w->n) {
+		w->q[(w->qb + w->qc) % w->nb] = w->cur;
+		w->qn[(w->qb + w->qc) % w->nb] = w->n;
+		w->qc++;
+		pthread_cond_signal(&w->cv_full);
+		while (!w->nfr) pthread_cond_wait(&w->cv_free, &w->mx);
+		w->cur = w->fr[--w->nfr];
+		w->n = 0;
+	}
+	pthread_mutex_unlock(&w->mx);
+}
+
+void ow_write(ow* w, const void* p, size_t k) {
+	const uchar* c = (const uchar*)p;
+	size_t m;
+	while (k) {
+		if (w->n == w->bsz) ow_next(w);
+		m = w->bsz - w->n < k ? w->bsz - w->n : k;
+		memcpy(w->cur + w->n, c, m);
+		w->n += m; c += m; k -= m;
+	}
+}
+
+bool ow_close(ow* w) {
+	uint i;
+	bool ok;
+	ow_next(w);
+	pthread_mutex_lock(&w->mx);
+	w->quit = TRUE;
+	pthread_cond_signal(&w->cv_full);
+	pthread_mutex_unlock(&w->mx);
+	pthread_join(w->th, NULL);
+	ok = !w->err && fflush(w->fp) == 0;
+	pz_free(w->cur);
+	forn(i, w->nfr) pz_free(w->fr[i]);
+	pz_free(w->fr);
+	pz_free(w->qn);
+	pz_free(w->q);
+	pthread_cond_destroy(&w->cv_free);
+	pthread_cond_destroy(&w->cv_full);
+	pthread_mutex_destroy(&w->mx);
+	return ok;
+}
+
+uchar* ow_utoa(uchar* b, uint64 x) {
+	uchar t[20];
+	uint k = 0;
+	do t[k++] = '0' + x % 10; while (x /= 10);
+	while (k) *b++ = t[--k];
+	return b;
+}
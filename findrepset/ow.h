@@ -0,0 +1,55 @@
+#ifndef __OW_H__
+#define __OW_H__
+
+#include <stdio.h>
+#include <pthread.h>
+
+#include "tipos.h"
+
+/** Asynchronous output writer.
+ *
+ * The producer fills one buffer while a writer thread writes the previous
+ * ones to fp, so formatting the output and writing it (for example to a
+ * pipe to gzip) overlap. Buffers are written in the order they are filled.
+ * Only one thread may write to an ow at a time.
+ */
+
+typedef struct {
+	FILE* fp;
+	pthread_t th;
+	pthread_mutex_t mx;
+	pthread_cond_t cv_full; /* there are buffers to write (or quit) */
+	pthread_cond_t cv_free; /* a buffer was written */
+	size_t bsz;
+	uint nb;
+	uchar** q;              /* filled buffers, in order */
+	size_t* qn;
+	uint qb, qc;
+	uchar** fr;             /* free buffers */
+	uint nfr;
+	uchar* cur;             /* buffer being filled, n bytes used */
+	size_t n;
+	bool quit, err;
+} ow;
+
+/** Starts a writer over fp with nb (at least 2) buffers of bsz bytes */
+void ow_init(ow* w, FILE* fp, size_t bsz, uint nb);
+
+/** Writes everything, stops the writer and frees the buffers; fp is left
+ * open and flushed. Returns FALSE if some write failed. */
+bool ow_close(ow* w);
+
+/** Hands the current buffer to the writer and takes a free one */
+void ow_next(ow* w);
+
+/** Returns room for at least k (<= bsz) bytes; ow_commit() the end */
+#define ow_reserve(w, k) ((w)->n + (k) > (w)->bsz ? (ow_next(w), (w)->cur) : (w)->cur + (w)->n)
+#define ow_commit(w, e) ((w)->n = (uchar*)(e) - (w)->cur)
+
+void ow_write(ow* w, const void* p, size_t k);
+#define ow_puts(w, str) ow_write(w, str, sizeof(str)-1)
+
+/** Writes x in decimal at b, returns the end */
+uchar* ow_utoa(uchar* b, uint64 x);
+
+#endif //__OW_H__
@@ -0,0 +1,24 @@
+#include "pidx.h"
+
+#ifdef LARGE_INDEX
+
+void pidx_set(pidx* a, uidx i, uidx v) {
+	a += PIDX_BYTES * i;
+	a[0] = v; a[1] = v >> 8; a[2] = v >> 16; a[3] = v >> 24; a[4] = v >> 32;
+}
+
+pidx* pidx_pack(uidx* a, uidx n) {
+	uidx i, v;
+	forn(i, n) { v = a[i]; pidx_set((pidx*)a, i, v); }
+	return (pidx*)emem_shrink(a, n * PIDX_BYTES);
+}
+
+uidx* pidx_unpack(pidx* a, uidx n) {
+	uidx* u = (uidx*)emem_malloc(n * sizeof(uidx));
+	uidx i;
+	forn(i, n) u[i] = pidx_get(a, i);
+	emem_free(a);
+	return u;
+}
+
+#endif
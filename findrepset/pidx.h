@@ -0,0 +1,60 @@
+#ifndef __PIDX_H__
+#define __PIDX_H__
+
+#include <stdlib.h>
+
+#include "tipos.h"
+#include "macros.h"
+#include "emem.h"
+
+/** Packed arrays of positions.
+ *
+ * In LARGE_INDEX builds each entry takes 40 bits (5 bytes) instead of the
+ * 8 bytes of an uidx, enough for inputs up to 1 TiB. They are used for
+ * the arrays that live until the end of the scan (the suffix array during
+ * the enumeration and the filter of own/common patterns), and for the
+ * suffix array and the PLCP while the LCP is built (see lcp.h). They are
+ * only accessed through pidx_get() and pidx_set().
+ * The suffix sorting itself (bwt(), sais(), esa_bwt()) stays on uidx:
+ * it gathers ranks at random, which took 2.1 times as long over 40-bit
+ * entries as over 8-byte ones.
+ * In the default build they are plain uint arrays.
+ * They are allocated with emem_malloc() and freed with emem_free().
+ */
+
+#ifdef LARGE_INDEX
+
+typedef uchar pidx;
+#define PIDX_BYTES 5
+#define PIDX_MAX ((((uidx)1) << 40) - 1)
+
+/* a and i are evaluated more than once */
+#define PIDX_B(a, i, k) ((uidx)(a)[PIDX_BYTES * (i) + (k)] << 8 * (k))
+#define pidx_get(a, i) \
+	(PIDX_B(a, i, 0) | PIDX_B(a, i, 1) | PIDX_B(a, i, 2) | PIDX_B(a, i, 3) | PIDX_B(a, i, 4))
+
+void pidx_set(pidx* a, uidx i, uidx v);
+
+#define pidx_malloc(n) ((pidx*)emem_malloc((n) * PIDX_BYTES))
+
+/** Packs the n entries of a in place and shrinks the buffer */
+pidx* pidx_pack(uidx* a, uidx n);
+
+/** The n entries of a back in a new uidx array; frees a */
+uidx* pidx_unpack(pidx* a, uidx n);
+
+#else
+
+typedef uint pidx;
+#define PIDX_BYTES sizeof(uint)
+#define PIDX_MAX ((uint)-1)
+
+#define pidx_get(a, i) ((a)[i])
+#define pidx_set(a, i, v) ((a)[i] = (v))
+#define pidx_malloc(n) ((pidx*)emem_malloc((n) * sizeof(uint)))
+#define pidx_pack(a, n) (a)
+#define pidx_unpack(a, n) (a)
+
+#endif
+
+#endif //__PIDX_H__
@@ -0,0 +1,103 @@
+#include "psort.h"
+#include "macros.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	psort* ps;
+	uint id;
+} psort_worker;
+
+/* Saca un trabajo de la cola. Se llama con el mutex tomado. */
+static bool psort_pop(psort* ps, psort_job* job) {
+	if (ps->qb == ps->qe) return FALSE;
+	*job = ps->q[ps->qb++];
+	if (ps->qb == ps->qe) ps->qb = ps->qe = 0;
+	return TRUE;
+}
+
+/* Corre un trabajo y lo descuenta. Se llama con el mutex tomado. */
+static void psort_run(psort* ps, psort_job* job, uint id) {
+	pthread_mutex_unlock(&ps->mx);
+	job->f(job->arg, id);
+	pthread_mutex_lock(&ps->mx);
+	if (!--ps->pending) pthread_cond_broadcast(&ps->cv_done);
+}
+
+static void* psort_thread(void* arg) {
+	psort_worker* w = (psort_worker*)arg;
+	psort* ps = w->ps;
+	psort_job job;
+	pthread_mutex_lock(&ps->mx);
+	while (TRUE) {
+		while (!ps->quit && !psort_pop(ps, &job)) pthread_cond_wait(&ps->cv_job, &ps->mx);
+		if (ps->quit) break;
+		psort_run(ps, &job, w->id);
+	}
+	pthread_mutex_unlock(&ps->mx);
+	pz_free(w);
+	return NULL;
+}
+
+void psort_init(psort* ps, uint threads) {
+	uint i;
+	psort_worker* w;
+	if (!threads) threads = 1;
+	memset(ps, 0, sizeof(psort));
+	ps->threads = threads;
+	pthread_mutex_init(&ps->mx, NULL);
+	pthread_cond_init(&ps->cv_job, NULL);
+	pthread_cond_init(&ps->cv_done, NULL);
+	ps->qsz = 64;
+	ps->q = (psort_job*)pz_malloc(ps->qsz * sizeof(psort_job));
+	ps->th = (pthread_t*)pz_malloc(threads * sizeof(pthread_t));
+	forn(i, threads-1) {
+		w = (psort_worker*)pz_malloc(sizeof(psort_worker));
+		w->ps = ps; w->id = i;
+		pthread_create(&ps->th[i], NULL, psort_thread, w);
+	}
+}
+
+void psort_destroy(psort* ps) {
+	uint i;
+	pthread_mutex_lock(&ps->mx);
+	ps->quit = TRUE;
+	pthread_cond_broadcast(&ps->cv_job);
+	pthread_mutex_unlock(&ps->mx);
+	forn(i, ps->threads-1) pthread_join(ps->th[i], NULL);
+	pthread_cond_destroy(&ps->cv_done);
+	pthread_cond_destroy(&ps->cv_job);
+	pthread_mutex_destroy(&ps->mx);
+	pz_free(ps->th);
+	pz_free(ps->q);
+}
+
+void psort_job_new(psort* ps, psort_func* f, void* arg) {
+	pthread_mutex_lock(&ps->mx);
+	if (ps->qe == ps->qsz) {
+		if (ps->qb) {
+			memmove(ps->q, ps->q + ps->qb, (ps->qe - ps->qb) * sizeof(psort_job));
+			ps->qe -= ps->qb; ps->qb = 0;
+		} else {
+			ps->qsz *= 2;
+			ps->q = (psort_job*)pz_realloc(ps->q, ps->qsz * sizeof(psort_job));
+		}
+	}
+	ps->q[ps->qe].f = f;
+	ps->q[ps->qe].arg = arg;
+	ps->qe++;
+	ps->pending++;
+	pthread_cond_signal(&ps->cv_job);
+	pthread_mutex_unlock(&ps->mx);
+}
+
+void psort_wait(psort* ps) {
+	psort_job job;
+	pthread_mutex_lock(&ps->mx);
+	while (ps->pending) {
+		if (psort_pop(ps, &job)) psort_run(ps, &job, ps->threads-1);
+		else pthread_cond_wait(&ps->cv_done, &ps->mx);
+	}
+	pthread_mutex_unlock(&ps->mx);
+}
@@ -0,0 +1,45 @@
+#ifndef __PSORT_H__
+#define __PSORT_H__
+
+#include <pthread.h>
+
+#include "tipos.h"
+
+/** Pool de threads para trabajos independientes (por ej. ordenar buckets).
+ *
+ * psort_init() crea threads-1 workers; el thread que llama a psort_wait()
+ * también ejecuta trabajos mientras espera, así que hay a lo sumo
+ * "threads" trabajos corriendo a la vez. Cada trabajo recibe el número
+ * de thread que lo ejecuta, en [0, threads), para que use memoria propia.
+ * Con threads == 1 no se crea ningún thread y psort_wait() corre todo.
+ */
+
+typedef void psort_func(void* arg, uint th);
+
+typedef struct {
+	psort_func* f;
+	void* arg;
+} psort_job;
+
+typedef struct {
+	uint threads;
+	pthread_t* th;
+	pthread_mutex_t mx;
+	pthread_cond_t cv_job;  /* hay trabajos en la cola (o hay que salir) */
+	pthread_cond_t cv_done; /* no quedan trabajos pendientes */
+	psort_job* q;           /* cola de trabajos [qb, qe) */
+	uint qb, qe, qsz;
+	uint pending;           /* trabajos encolados o en curso */
+	bool quit;
+} psort;
+
+void psort_init(psort* ps, uint threads);
+void psort_destroy(psort* ps);
+
+/** Encola un trabajo; vuelve sin esperar a que se ejecute */
+void psort_job_new(psort* ps, psort_func* f, void* arg);
+
+/** Espera (ayudando) a que terminen todos los trabajos encolados */
+void psort_wait(psort* ps);
+
+#endif //__PSORT_H__
@@ -0,0 +1,109 @@
+#include "radix.h"
+#include "macros.h"
+#include "psort.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_DIGITS (sizeof(uidx) * 8 / RADIX_BITS)
+
+static void radix_insertion(qpair* a, uidx n) {
+	uidx i, j;
+	qpair x;
+	forsn(i, 1, n) {
+		x = a[i];
+		for(j = i; j > 0 && QP_VAL(&x) < QP_VAL(&a[j-1]); --j) a[j] = a[j-1];
+		a[j] = x;
+	}
+}
+
+void radix_pairs(qpair* a, qpair* tmp, uidx n) {
+	uidx cnt[RADIX_DIGITS][RADIX_SIZE];
+	uidx i, v, s;
+	uint d, sh;
+	qpair *src = a, *dst = tmp, *x;
+	if (n < RADIX_SMALL) { radix_insertion(a, n); return; }
+
+	/* the counts of every digit in one pass */
+	memset(cnt, 0, sizeof(cnt));
+	forn(i, n) {
+		v = QP_VAL(&a[i]);
+		forn(d, RADIX_DIGITS) ++cnt[d][(v >> (d * RADIX_BITS)) & (RADIX_SIZE-1)];
+	}
+
+	forn(d, RADIX_DIGITS) {
+		sh = d * RADIX_BITS;
+		/* all the values share this digit */
+		if (cnt[d][(QP_VAL(&a[0]) >> sh) & (RADIX_SIZE-1)] == n) continue;
+		for(i = s = 0; i < RADIX_SIZE; ++i) { v = cnt[d][i]; cnt[d][i] = s; s += v; }
+		forn(i, n) {
+			x = &src[i];
+			dst[cnt[d][(QP_VAL(x) >> sh) & (RADIX_SIZE-1)]++] = *x;
+		}
+		x = src; src = dst; dst = x;
+	}
+	if (src != a) memcpy(a, src, n * sizeof(qpair));
+}
+
+/*** Counting sort ***/
+
+typedef struct {
+	uidx* out;
+	uidx* cnt;     /* hi-lo+1 counters of this block */
+	uidx b, e, lo;
+	radix_key* key;
+	void* data;
+} radix_block;
+
+#define RADIX_KEY(bl, i, k) { k = (bl)->key((bl)->data, i); k = k < (bl)->lo ? 0 : k - (bl)->lo; }
+
+static void radix_count_block(void* arg, uint th) {
+	radix_block* bl = (radix_block*)arg;
+	uidx i, k;
+	(void)th;
+	forsn(i, bl->b, bl->e) { RADIX_KEY(bl, i, k); ++bl->cnt[k]; }
+}
+
+static void radix_scatter_block(void* arg, uint th) {
+	radix_block* bl = (radix_block*)arg;
+	uidx i, k;
+	(void)th;
+	forsn(i, bl->b, bl->e) { RADIX_KEY(bl, i, k); bl->out[bl->cnt[k]++] = i; }
+}
+
+void radix_count(uidx* out, uidx n, uidx lo, uidx hi, radix_key* key, void* data, uint threads) {
+	uidx i, k, s, v, nk, nb, step;
+	uidx* cnt;
+	radix_block* bl;
+	psort ps;
+	if (!n) return;
+	if (hi < lo) hi = lo;
+	nk = hi - lo + 1;
+	nb = threads > 1 && (uidx)threads * nk <= n ? threads : 1;
+	step = (n + nb - 1) / nb;
+	cnt = (uidx*)pz_malloc(nb * nk * sizeof(uidx));
+	memset(cnt, 0, nb * nk * sizeof(uidx));
+	bl = (radix_block*)pz_malloc(nb * sizeof(radix_block));
+	forn(i, nb) {
+		bl[i].out = out; bl[i].cnt = cnt + i * nk;
+		bl[i].b = i * step < n ? i * step : n;
+		bl[i].e = bl[i].b + step < n ? bl[i].b + step : n;
+		bl[i].lo = lo; bl[i].key = key; bl[i].data = data;
+	}
+
+	psort_init(&ps, nb);
+	forn(i, nb) psort_job_new(&ps, radix_count_block, &bl[i]);
+	psort_wait(&ps);
+	/* each block starts after the smaller keys, and after the earlier
+	 * blocks for its own key */
+	s = 0;
+	forn(k, nk) forn(i, nb) { v = bl[i].cnt[k]; bl[i].cnt[k] = s; s += v; }
+	forn(i, nb) psort_job_new(&ps, radix_scatter_block, &bl[i]);
+	psort_wait(&ps);
+	psort_destroy(&ps);
+
+	pz_free(bl);
+	pz_free(cnt);
+}
@@ -0,0 +1,46 @@
+#ifndef __RADIX_H__
+#define __RADIX_H__
+
+#include "tipos.h"
+
+/** Radix and counting sorts, in place of the qsort3 of sorters.h where
+ * the keys are integers.
+ *
+ * radix_pairs() sorts (value, index) pairs by value, LSD a byte at a time
+ * and skipping the bytes that are the same in every value.
+ * radix_count() orders the indexes [0, n) by a bounded integer key.
+ * Both are stable and take no locks, so they can run in several threads.
+ */
+
+/* Par (valor, indice) para ordenar por copia. Con indices de 32 bits
+ * entra en un entero de 64 bits, con LARGE_INDEX es un struct. */
+#ifdef LARGE_INDEX
+typedef struct { uidx v, i; } qpair;
+#define QP_VAL(X) ((X)->v)
+#define QP_IDX(X) ((X)->i)
+#define QP_SET(X, val, idx) { (X)->v = (val); (X)->i = (idx); }
+#else
+typedef uint64 qpair;
+#define QP_VAL(X) ((uint)*(X))
+#define QP_IDX(X) ((uint)(*(X) >> 32))
+#define QP_SET(X, val, idx) { *(X) = (uint64)(val) | ((uint64)(idx) << 32); }
+#endif
+
+/** Below this many pairs radix_pairs() uses insertion sort */
+#define RADIX_SMALL 32
+
+/** Sorts the pairs a[0, n) by value; tmp is scratch for n pairs */
+void radix_pairs(qpair* a, qpair* tmp, uidx n);
+
+/** Key of the index i, for radix_count() */
+typedef uidx radix_key(void* data, uidx i);
+
+/** Leaves in out the indexes [0, n) ordered by key(data, i), equal keys in
+ * increasing index order. The keys must be at most hi; those below lo are
+ * taken as lo. Uses hi-lo+1 counters, or one set per thread when
+ * threads > 1 and they all fit in n: the counts and the scatter are then
+ * split in blocks of indexes that run in parallel.
+ */
+void radix_count(uidx* out, uidx n, uidx lo, uidx hi, radix_key* key, void* data, uint threads);
+
+#endif //__RADIX_H__
@@ -81,7 +81,7 @@ int main(int argc, char** argv) {
 		memcpy(st, s, sn);
 		memcpy(st+sn, t[i], tn[i]);
 
-		bwt(NULL, p, r, st, n, NULL);
+		bwt(NULL, p, r, st, n, NULL, NULL);
 		forn(j,n) p[r[j]]=j;
 		memcpy(h, r, n*sizeof(uint));
 		lcp(n, st, h, p);
@@ -113,7 +113,7 @@ int main(int argc, char** argv) {
 	r = (uint*)pz_malloc(sn*sizeof(uint));
 	h = (uint*)pz_malloc(sn*sizeof(uint));
 	
-	bwt(NULL, p, r, s, sn, NULL);
+	bwt(NULL, p, r, s, sn, NULL, NULL);
 	forn(j,sn) p[r[j]]=j;
 	memcpy(h, r, sn*sizeof(uint));
 	lcp(sn, s, h, p);
@@ -0,0 +1,144 @@
+#include "sais.h"
+#include "bwt.h"
+#include "bitarray.h"
+#include "macros.h"
+#include "emem.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Induced sorting (SA-IS), after Nong, Zhang & Chan (2009).
+ * The string s is either of uchar (cs == 1) or of uidx (cs == sizeof(uidx),
+ * used by the recursion), over the alphabet [0, K).
+ * Position n is a virtual sentinel, smaller than any character. */
+
+#define EMPTY ((uidx)-1)
+
+#define chr(i) (cs == sizeof(uidx) ? ((uidx*)s)[i] : ((uchar*)s)[i])
+/* t marks the S-type suffixes */
+#define is_s(i) bita_get(t, i)
+#define is_lms(i) ((i) > 0 && is_s(i) && !is_s((i)-1))
+
+static void get_buckets(void* s, uidx* bkt, uidx n, uidx K, uint cs, bool end) {
+	uidx i, sum = 0;
+	forn(i, K) bkt[i] = 0;
+	forn(i, n) bkt[chr(i)]++;
+	forn(i, K) { sum += bkt[i]; bkt[i] = end ? sum : sum - bkt[i]; }
+}
+
+/*** Induce L-type suffixes from the sorted LMS ones, then S-type from L ***/
+static void induce(void* s, uidx* sa, bitarray* t, uidx* bkt, uidx n, uidx K, uint cs) {
+	uidx i, j;
+	get_buckets(s, bkt, n, K, cs, FALSE);
+	/* the suffix n-1 is preceded by the sentinel, the first one */
+	sa[bkt[chr(n-1)]++] = n-1;
+	forn(i, n) {
+		j = sa[i];
+		if (j != EMPTY && j > 0 && !is_s(j-1)) sa[bkt[chr(j-1)]++] = j-1;
+	}
+	get_buckets(s, bkt, n, K, cs, TRUE);
+	dforn(i, n) {
+		j = sa[i];
+		if (j != EMPTY && j > 0 && is_s(j-1)) sa[--bkt[chr(j-1)]] = j-1;
+	}
+}
+
+static void sais_main(void* s, uidx* sa, uidx n, uidx K, uint cs) {
+	uidx i, j, d, n1, name, pos, prev;
+	uidx* bkt, *s1;
+	bitarray* t;
+	bool diff;
+
+	if (n == 1) { sa[0] = 0; return; }
+
+	/* Classify the suffixes, the last one is L-type */
+	t = (bitarray*)emem_malloc((n / ba_word_size + 1) * sizeof(bitarray));
+	memset(t, 0, (n / ba_word_size + 1) * sizeof(bitarray));
+	dforn(i, n-1) {
+		if (chr(i) < chr(i+1) || (chr(i) == chr(i+1) && is_s(i+1))) bita_set(t, i);
+	}
+	bkt = (uidx*)pz_malloc(K * sizeof(uidx));
+
+	/* Stage 1: sort the LMS substrings */
+	get_buckets(s, bkt, n, K, cs, TRUE);
+	forn(i, n) sa[i] = EMPTY;
+	forsn(i, 1, n) if (is_lms(i)) sa[--bkt[chr(i)]] = i;
+	induce(s, sa, t, bkt, n, K, cs);
+
+	/* Compact the sorted LMS substrings at the beginning of sa */
+	n1 = 0;
+	forn(i, n) if (is_lms(sa[i])) sa[n1++] = sa[i];
+
+	/* Name them. LMS positions are at least 2 apart, so the names of
+	 * pos fit in sa[n1 + pos/2] */
+	forsn(i, n1, n) sa[i] = EMPTY;
+	name = 0; prev = EMPTY;
+	forn(i, n1) {
+		pos = sa[i];
+		diff = TRUE;
+		if (prev != EMPTY) for(d = 0;; ++d) {
+			if (pos+d == n || prev+d == n) break;
+			if (chr(pos+d) != chr(prev+d) || is_s(pos+d) != is_s(prev+d)) break;
+			if (d > 0 && (is_lms(pos+d) || is_lms(prev+d))) {
+				diff = !(is_lms(pos+d) && is_lms(prev+d));
+				break;
+			}
+		}
+		if (diff) { name++; prev = pos; }
+		sa[n1 + pos/2] = name-1;
+	}
+	for(i = j = n; i-- > n1;) if (sa[i] != EMPTY) sa[--j] = sa[i];
+	s1 = sa + n - n1;
+
+	/* Stage 2: sort the reduced string, recursing if names are repeated */
+	if (name < n1) {
+		pz_free(bkt);
+		sais_main(s1, sa, n1, name, sizeof(uidx));
+		bkt = (uidx*)pz_malloc(K * sizeof(uidx));
+	} else {
+		forn(i, n1) sa[s1[i]] = i;
+	}
+
+	/* Stage 3: induce the final order from the sorted LMS suffixes */
+	j = 0;
+	forsn(i, 1, n) if (is_lms(i)) s1[j++] = i;
+	forn(i, n1) sa[i] = s1[sa[i]];
+	forsn(i, n1, n) sa[i] = EMPTY;
+	get_buckets(s, bkt, n, K, cs, TRUE);
+	dforn(i, n1) {
+		j = sa[i]; sa[i] = EMPTY;
+		sa[--bkt[chr(j)]] = j;
+	}
+	induce(s, sa, t, bkt, n, K, cs);
+
+	pz_free(bkt);
+	emem_free(t);
+}
+
+void sais(uchar* s, uidx* r, uidx n) {
+	if (n) sais_main(s, r, n, 256, sizeof(uchar));
+}
+
+void sais_int(uidx* s, uidx* r, uidx n, uidx K) {
+	if (n) sais_main(s, r, n, K, sizeof(uidx));
+}
+
+void sais_bwt(uchar *bw, uidx* p, uidx* r, uchar* src, uidx n, uidx* prim, const bwt_opts* o) {
+	uidx i, *q;
+	uchar *s = src?src:(uchar*)p;
+	uidx c[256];
+	memset(c, 0, sizeof(c));
+	forn(i, n) ++c[s[i]];
+	if (c[s[n-1]] != 1) {
+		fprintf(stderr, "sais: last character is not unique, using bwt()\n");
+		/* bwt() ranks the rotations in p */
+		q = p ? p : (uidx*)emem_malloc(n * sizeof(uidx));
+		bwt(bw, q, r, src, n, prim, o);
+		if (q != p) emem_free(q);
+		return;
+	}
+	sais(s, r, n);
+	if (prim) forn(i, n) if (!r[i]) { *prim = i; break; }
+	if (bw && src) forn(i, n) p[r[i]] = i;
+	if (bw || p) bwt_out_bc(bw, p, r, src, n, c);
+}
@@ -0,0 +1,32 @@
+#ifndef __SAIS_H__
+#define __SAIS_H__
+
+#include "tipos.h"
+#include "bwt.h"
+
+/** sais() builds the suffix array of the string s of length n into r
+ * using induced sorting (SA-IS), in O(n) time.
+ *
+ * The end of s is treated as a virtual sentinel smaller than any
+ * character. When s[n-1] is unique in s this gives the same order as the
+ * rotations sorted by bwt().
+ * Uses n bits plus a 256-entry bucket table beyond r (more in the
+ * recursion, bounded by 2n bytes).
+ */
+void sais(uchar* s, uidx* r, uidx n);
+
+/** sais_int() is sais() over a string of integers in [0, K) */
+void sais_int(uidx* s, uidx* r, uidx n, uidx K);
+
+/** sais_bwt() is a drop-in replacement of bwt() (same parameters and
+ * output, see bwt.h) built on sais(). It always sorts completely, on one
+ * thread; o is only passed to the fallback below. p may be NULL if bw is
+ * NULL and src is not: then only r and prim are computed.
+ *
+ * If the last character of the input is not unique the order of the
+ * rotations may differ from the order of the suffixes, so it falls back
+ * to bwt().
+ */
+void sais_bwt(uchar *bw, uidx* p, uidx* r, uchar* src, uidx n, uidx* prim, const bwt_opts* o);
+
+#endif //__SAIS_H__
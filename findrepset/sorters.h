@@ -1,6 +1,8 @@
 #ifndef __SORTERS_H__
 #define __SORTERS_H__
 
+#include "tipos.h"
+
 #define SWAP_T(tipo, a,b) { const tipo _tmp = *(a); *(a) = *(b); *(b)=_tmp;}
 
 /** QSORT que parte el arreglo en tres partes, una con los <pivote, el pivote, >=pivote
@@ -31,12 +33,23 @@ void nombre(tipo* b, tipo* e) { \
 //#define _qshow(X) { uint64* p = b; fprintf(stderr, "%s[%lX, %lX, %lX)  vp=%3d  ", X, (long unsigned int)bp, (long unsigned int)cp, (long unsigned int)ep, (int)vp); for(p=b;p<e;++p) fprintf(stderr, "%d ", (int)*p); fprintf(stderr, "\n"); }
 #define _qshow(X)
 
+/** Pivotes al azar con un xorshift64 por thread: rand() toma el lock de la
+ * libc en cada llamada y comparte el estado entre threads.
+ * Para claves enteras conviene radix.h. */
+static __thread uint64 sorters_seed = 0x9E3779B97F4A7C15ULL;
+
+static inline uint64 sorters_rand(void) {
+	uint64 x = sorters_seed;
+	x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+	return sorters_seed = x;
+}
+
 #define _def_qsort3(nombre, tipo, tipoval, VL, OP) \
 void nombre(tipo* b, tipo* e) { \
 	tipo *bp, *ep, *cp; \
 	tipoval vp, vcp; \
 	if (b >= e-1) return; \
-	cp = b+(rand()%(e-b)); \
+	cp = b+(sorters_rand()%(e-b)); \
 	vp = (VL(cp)); /* pivote */\
 	bp = cp = b; \
 	ep = e; \
@@ -0,0 +1,150 @@
+#include "sparse.h"
+#include "sais.h"
+#include "common.h"
+#include "emem.h"
+#include "macros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NONE ((uidx)-1)
+
+uidx* sparse_load(const char* fn, uidx n, uidx* m) {
+	uchar* bv;
+	uidx bn, i, k = 0;
+	uidx* b;
+	bool mapped;
+	if (!(bv = mapStrFileExtraSpace(fn, &bn, 0, &mapped))) return NULL;
+	if (bn != (n-1+7) / 8) {
+		fprintf(stderr, "Boundaries %s do not match the input\n", fn);
+		unmapStrFile(bv, bn, 0, mapped);
+		return NULL;
+	}
+	forn(i, n-1) k += (bv[i >> 3] >> (i & 7)) & 1;
+	b = (uidx*)emem_malloc((k+1) * sizeof(uidx));
+	k = 0;
+	forn(i, n-1) if ((bv[i >> 3] >> (i & 7)) & 1) b[k++] = i;
+	b[k++] = n-1;
+	unmapStrFile(bv, bn, 0, mapped);
+	*m = k;
+	return b;
+}
+
+/*** Segment names ***/
+
+/* The segment k is s[b[k], b[k+1]) */
+#define seg_len(k) (b[(k)+1] - b[k])
+
+/* Character d of the segment k, -1 past its end */
+#define seg_chr(k, d) ((d) < seg_len(k) ? (int)s[b[k] + (d)] : -1)
+
+/* Sorts the n segments u, which share their first d characters, with a
+ * multikey quicksort; a segment goes before the longer ones it starts */
+static void sparse_sort(uidx* u, uidx n, uchar* s, uidx* b, uidx d) {
+	uidx lt, gt, i, x;
+	int v, c;
+	while (n > 1) {
+		v = seg_chr(u[n/2], d);
+		lt = i = 0; gt = n;
+		while (i < gt) {
+			c = seg_chr(u[i], d);
+			if (c < v) { x = u[lt]; u[lt++] = u[i]; u[i++] = x; }
+			else if (c > v) { x = u[--gt]; u[gt] = u[i]; u[i] = x; }
+			else ++i;
+		}
+		sparse_sort(u, lt, s, b, d);
+		sparse_sort(u + gt, n - gt, s, b, d);
+		if (v < 0) break;
+		u += lt; n = gt - lt; ++d;
+	}
+}
+
+static inline uint64 sparse_hash(uchar* x, uidx l) {
+	uint64 h = 0xcbf29ce484222325ULL;
+	while (l--) h = (h ^ *x++) * 0x100000001b3ULL;
+	return h;
+}
+
+/* Names the segments 0..m-2 in t, by rank among the distinct ones; the
+ * sentinel segment m-1 gets the largest name. Returns the number of names. */
+static uidx sparse_names(uchar* s, uidx* b, uidx m, uidx* t) {
+	uidx k, j, x, nd = 0, usz = 1024, hsz = 1 << 16;
+	uidx *u, *ht, *rk;
+	u = (uidx*)pz_malloc(usz * sizeof(uidx));
+	ht = (uidx*)pz_malloc(hsz * sizeof(uidx));
+	forn(j, hsz) ht[j] = NONE;
+
+	/* Distinct segments, numbered by first occurrence: u[x] is the first
+	 * segment named x, ht holds the names by hash */
+	forn(k, m-1) {
+		j = sparse_hash(s + b[k], seg_len(k)) & (hsz - 1);
+		while ((x = ht[j]) != NONE && (seg_len(u[x]) != seg_len(k)
+				|| memcmp(s + b[u[x]], s + b[k], seg_len(k))))
+			j = (j + 1) & (hsz - 1);
+		if (x == NONE) {
+			if (nd == usz) { usz *= 2; u = (uidx*)pz_realloc(u, usz * sizeof(uidx)); }
+			u[x = nd++] = k;
+			ht[j] = x;
+			if (2 * nd > hsz) {
+				pz_free(ht);
+				hsz *= 2;
+				ht = (uidx*)pz_malloc(hsz * sizeof(uidx));
+				forn(j, hsz) ht[j] = NONE;
+				forn(x, nd) {
+					j = sparse_hash(s + b[u[x]], seg_len(u[x])) & (hsz - 1);
+					while (ht[j] != NONE) j = (j + 1) & (hsz - 1);
+					ht[j] = x;
+				}
+				x = nd-1;
+			}
+		}
+		t[k] = x;
+	}
+	pz_free(ht);
+
+	/* Renamed by rank; the first segment named x is u[x], so t[u[x]] = x */
+	rk = (uidx*)pz_malloc((nd ? nd : 1) * sizeof(uidx));
+	sparse_sort(u, nd, s, b, 0);
+	forn(x, nd) rk[t[u[x]]] = x;
+	forn(k, m-1) t[k] = rk[t[k]];
+	t[m-1] = nd;
+	pz_free(rk);
+	pz_free(u);
+	return nd;
+}
+
+void sparse_sa(uchar* s, uidx n, uidx* b, uidx m, uidx* r, uidx* p, left_ctx* lc) {
+	uidx i, k, j, l, x, y, nd;
+	uidx* t;
+
+	t = (uidx*)emem_malloc(m * sizeof(uidx));
+	nd = sparse_names(s, b, m, t);
+	sais_int(t, r, m, nd+1);
+
+	memset(lc, 0, sizeof(left_ctx));
+	lc->lid = (uidx*)emem_malloc(m * sizeof(uidx));
+	lc->nid = nd + 1;
+	forn(i, m) {
+		if (r[i]) lc->lid[i] = t[r[i]-1];
+		else { lc->lid[i] = 0; lc->prim = i; }
+	}
+	emem_free(t);
+
+	/* Phi, then the PLCP in place. If the suffix at b[k] shares l > the
+	 * length of segment k with its predecessor, both continue at a boundary
+	 * and in the same order, so the next suffix shares at least the rest. */
+	p[r[0]] = NONE;
+	forsn(i, 1, m) p[r[i]] = r[i-1];
+	l = 0;
+	forn(k, m) {
+		if ((j = p[k]) == NONE) {
+			l = 0;
+		} else {
+			x = b[k]; y = b[j];
+			while (x+l < n && y+l < n && s[x+l] == s[y+l]) ++l;
+		}
+		p[k] = l;
+		if (k+1 < m) l = l > seg_len(k) ? l - seg_len(k) : 0;
+	}
+}
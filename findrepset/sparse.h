@@ -0,0 +1,40 @@
+#ifndef __SPARSE_H__
+#define __SPARSE_H__
+
+#include "tipos.h"
+#include "bwt.h"
+
+/** Sparse suffix array: only the suffixes of s starting at a set of
+ * boundaries (line and token starts, see the preprocessor's --bounds) are
+ * sorted, so the arrays have one entry per boundary instead of one per byte.
+ *
+ * The boundaries b[0] < ... < b[m-1] split s in segments. Whether i is a
+ * boundary must depend only on s[i-1] and s[i] (or i == 0), so every
+ * occurrence of a string at a boundary is split in the same way.
+ * Each segment is named by its rank among the distinct segments and the
+ * suffix array of the names is built with sais_int(). This is not the
+ * lexicographical order of the suffixes, but the suffixes sharing any prefix
+ * are still contiguous, so the lcp-intervals are the same and the kernels
+ * of mrs.h and mmrs.h work unchanged over it.
+ *
+ * A repeat is left maximal when its occurrences are not all preceded by the
+ * same segment (extending it by one character would leave the index).
+ */
+
+/** Reads the boundary bitvector fn (bit i&7 of byte i>>3 set if a boundary
+ * starts at i) of a text of n bytes, the last one being the sentinel.
+ * Returns the boundaries below n-1 followed by n-1, and their number in *m.
+ * NULL if fn can not be read or does not match n. */
+uidx* sparse_load(const char* fn, uidx n, uidx* m);
+
+/** Sorts the suffixes of s (of length n) starting at the m boundaries b,
+ * where b[m-1] = n-1.
+ * r gets the suffix array as indexes in b (b[r[i]] is the i-th suffix), and
+ * p at k the LCP, in characters, of the suffix at b[k] with the previous
+ * one in r (the PLCP, as lcp_plcp() leaves it).
+ * lc gets the names of the segments before each suffix in lid (allocated
+ * with emem_malloc()); lc->prim is the rank of the first suffix.
+ */
+void sparse_sa(uchar* s, uidx n, uidx* b, uidx m, uidx* r, uidx* p, left_ctx* lc);
+
+#endif //__SPARSE_H__
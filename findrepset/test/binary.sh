@@ -0,0 +1,34 @@
+#!/bin/sh
+# -b: the postprocessor writes the same repeats from the binary stream as
+# from the text output.
+# Usage: binary.sh <preprocessor> <findrepset> <postprocessor>
+P=$1
+B=$2
+Q=$3
+T=$(cd "$(dirname "$0")" && pwd)
+. "$T/gen.sh"
+D=$(mktemp -d) || exit 1
+trap 'rm -rf "$D"' EXIT
+cd "$D" || exit 1
+
+mkdir src
+gen 6000 1 "97 98 99 32 10" > x
+{ gen 3000 2 "97 98 99 32 10"; head -c 2000 x; } > src/a.txt
+{ head -c 4000 x; gen 2000 3 "97 100 32 10"; } > src/b.txt
+gen 3000 4 "97 98 99 32 10" > src/c.txt
+"$P" src x.concat x.charmap --linemap x.linemap >/dev/null 2>&1 || exit 1
+fail=0
+
+for opt in "" "-nm" "-nm -sortmrs" "-files x.charmap"; do
+	case $opt in
+	-files*) po=--whole-files ;;
+	*) po= ;;
+	esac
+	"$B" x.concat $opt -ml 10 -o a 2>/dev/null || fail=1
+	"$B" x.concat $opt -ml 10 -b -o b 2>/dev/null || fail=1
+	"$Q" a x.charmap x.linemap pa $po >/dev/null 2>&1 || fail=1
+	"$Q" b x.charmap x.linemap pb $po --concat x.concat >/dev/null 2>&1 || fail=1
+	if [ ! -s pa ] || ! cmp -s pa pb; then echo "$opt: -b differs"; fail=1; fi
+done
+
+exit $fail
@@ -0,0 +1,25 @@
+#!/bin/sh
+# -clcp gives the same repeats as the full LCP array, with repeats long
+# enough to go to the exceptions.
+# Usage: clcp.sh <findrepset>
+B=$1
+T=$(cd "$(dirname "$0")" && pwd)
+. "$T/gen.sh"
+D=$(mktemp -d) || exit 1
+trap 'rm -rf "$D"' EXIT
+cd "$D" || exit 1
+
+fail=0
+
+# 300 and 2000 characters repeated
+gen 2000 1 "97 98 99 10" > x
+{ cat x; gen 5000 2 "0 97 98 99 100 10"; cat x; head -c 300 x; gen 5000 3 "97 98 10"; } > s
+{ gen 3000 4 "97 98 99"; cat x; } > t
+for opt in "s" "s -nm" "s -nm -sortmrs" "s t -c" "s t -c -ms"; do
+	"$B" $opt -ml 5 -o a 2>/dev/null || fail=1
+	"$B" $opt -ml 5 -clcp -o b 2>/dev/null || fail=1
+	if ! grep -q '^Repeat size: 2...$' a; then echo "$opt: no long repeat"; fail=1; fi
+	if ! cmp -s a b; then echo "$opt: -clcp differs"; fail=1; fi
+done
+
+exit $fail
@@ -0,0 +1,37 @@
+#!/bin/sh
+# -files gives the same repeats as files that already end with a unique
+# byte, which no repeat can span either, in another order.
+# Usage: files.sh <findrepset>
+B=$1
+T=$(cd "$(dirname "$0")" && pwd)
+. "$T/gen.sh"
+D=$(mktemp -d) || exit 1
+trap 'rm -rf "$D"' EXIT
+cd "$D" || exit 1
+
+# the records of the output without their suffix array interval, one per
+# line, sorted; the text has no blank lines, so the records are the
+# paragraphs
+records() {
+	LC_ALL=C awk 'BEGIN { RS = "" } { sub(/\nSuffix array interval[^\n]*/, ""); gsub(/\n/, "|"); print }' "$1" | LC_ALL=C sort
+}
+
+fail=0
+
+# x is split between the end of a and the start of b, and whole in c;
+# no 255, which the run without -files takes for its sentinel
+gen 4000 1 "97 98 99 32 254" > x
+{ gen 3000 2 "97 98 99 32"; head -c 1500 x; printf '\001'; } > a
+{ tail -c 2500 x; gen 3000 3 "97 98 32 254"; printf '\002'; } > b
+{ gen 2000 4 "97 98 99 32 254"; head -c 4000 x; } > c
+cat a b c > s
+printf '0\ta\n%d\tb\n%d\tc\n' $(wc -c < a) $(( $(wc -c < a) + $(wc -c < b) )) > s.charmap
+for opt in "" "-nm" "-clcp" "-threads 3"; do
+	"$B" s $opt -ml 5 -o o 2>/dev/null || fail=1
+	records o > ra
+	"$B" s $opt -ml 5 -files s.charmap -o o 2>/dev/null || fail=1
+	records o > rb
+	if [ ! -s ra ] || ! cmp -s ra rb; then echo "$opt: -files differs"; fail=1; fi
+done
+
+exit $fail
@@ -0,0 +1,18 @@
+# Sourced by the tests.
+# gen n seed "bytes": n pseudo-random bytes over the given ones, with some
+# copied stretches
+gen() {
+	LC_ALL=C awk -v n="$1" -v seed="$2" -v al="$3" 'BEGIN {
+		k = split(al, a, " "); x = seed
+		for (i = 0; i < n; i++) {
+			x = (x * 1103515245 + 12345) % 2147483648
+			b[i] = a[int(x / 65536) % k + 1]
+		}
+		for (j = 0; j < 20; j++) {
+			x = (x * 1103515245 + 12345) % 2147483648; f = int(x / 65536) % (n - 30)
+			x = (x * 1103515245 + 12345) % 2147483648; g = int(x / 65536) % (n - 30)
+			for (i = 0; i < 25; i++) b[g+i] = b[f+i]
+		}
+		for (i = 0; i < n; i++) printf "%c", b[i]
+	}'
+}
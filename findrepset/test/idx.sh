@@ -0,0 +1,36 @@
+#!/bin/sh
+# -idx: the index saved by one run is loaded by the next with the same
+# repeats, and an index of another text is rebuilt.
+# Usage: idx.sh <findrepset>
+B=$1
+T=$(cd "$(dirname "$0")" && pwd)
+. "$T/gen.sh"
+D=$(mktemp -d) || exit 1
+trap 'rm -rf "$D"' EXIT
+cd "$D" || exit 1
+
+fail=0
+
+gen 20000 1 "0 97 98 99 10" > s
+gen 20000 2 "0 97 98 99 10" > s2
+gen 5000 3 "97 98 99 10" > t
+for opt in "s" "s -nm" "s t -c -ms"; do
+	rm -f x
+	"$B" $opt -ml 5 -o a 2>/dev/null || fail=1
+	"$B" $opt -ml 5 -idx x -o b 2>/dev/null || fail=1
+	"$B" $opt -ml 5 -idx x -o c 2>e || fail=1
+	grep -q 'Loaded index' e || { echo "$opt: index not loaded"; fail=1; }
+	if [ ! -s a ] || ! cmp -s a b || ! cmp -s a c; then echo "$opt: -idx differs"; fail=1; fi
+	# the LCP as saved, whatever -clcp says
+	"$B" $opt -ml 5 -clcp -idx x -o c 2>/dev/null || fail=1
+	if ! cmp -s a c; then echo "$opt: -idx -clcp differs"; fail=1; fi
+	# the same length, other bytes
+	set -- $opt
+	shift
+	"$B" s2 "$@" -ml 5 -o a 2>/dev/null || fail=1
+	"$B" s2 "$@" -ml 5 -idx x -o b 2>e || fail=1
+	grep -q 'does not match' e || { echo "$opt: stale index not rebuilt"; fail=1; }
+	if [ ! -s a ] || ! cmp -s a b; then echo "$opt: stale -idx differs"; fail=1; fi
+done
+
+exit $fail
@@ -0,0 +1,24 @@
+#!/bin/sh
+# --low-mem gives the same repeats as the default build of the index with
+# -sais, which it implies (with -maxl, the suffixes equal up to the cap
+# are in the order of the sort), and shows the peak of each phase.
+# Usage: low_mem.sh <findrepset>
+B=$1
+T=$(cd "$(dirname "$0")" && pwd)
+. "$T/gen.sh"
+D=$(mktemp -d) || exit 1
+trap 'rm -rf "$D"' EXIT
+cd "$D" || exit 1
+
+fail=0
+
+{ gen 2000 1 "97 98 99 10"; gen 20000 2 "0 97 98 99 100 10"; gen 2000 1 "97 98 99 10"; } > s
+gen 5000 3 "97 98 99 10" > t
+for opt in "s" "s -nm" "s -maxl 30" "s -threads 3" "s t -c" "s t -c -ms" "s --mem-budget 64K"; do
+	"$B" $opt -ml 5 -sais -o a 2>/dev/null || fail=1
+	"$B" $opt -ml 5 --low-mem -o b 2>e || fail=1
+	grep -q 'LCP' e || { echo "$opt: no peaks"; fail=1; }
+	if [ ! -s a ] || ! cmp -s a b; then echo "$opt: --low-mem differs"; fail=1; fi
+done
+
+exit $fail
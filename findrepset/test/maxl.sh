@@ -0,0 +1,27 @@
+#!/bin/sh
+# -maxl over the longest repeat sorts deep enough for the same repeats as
+# without it, and a lower one caps their length.
+# Usage: maxl.sh <findrepset>
+B=$1
+T=$(cd "$(dirname "$0")" && pwd)
+. "$T/gen.sh"
+D=$(mktemp -d) || exit 1
+trap 'rm -rf "$D"' EXIT
+cd "$D" || exit 1
+
+fail=0
+
+# the longest repeat has 2000 characters
+gen 2000 1 "97 98 99 10" > x
+{ cat x; gen 20000 2 "0 97 98 99 100 10"; cat x; gen 5000 3 "97 98 10"; } > s
+for opt in "" "-nm" "-sais" "-clcp" "-threads 3"; do
+	"$B" s $opt -ml 5 -o a 2>/dev/null || fail=1
+	"$B" s $opt -ml 5 -maxl 2100 -o b 2>/dev/null || fail=1
+	if [ ! -s a ] || ! cmp -s a b; then echo "$opt: -maxl 2100 differs"; fail=1; fi
+	"$B" s $opt -ml 5 -maxl 40 -o b 2>/dev/null || fail=1
+	if ! grep -q '^Repeat size: 40$' b || grep -a '^Repeat size: ' b | awk '$3 > 40 { f = 1 } END { exit !f }'; then
+		echo "$opt: -maxl 40 not capped"; fail=1
+	fi
+done
+
+exit $fail
@@ -0,0 +1,23 @@
+#!/bin/sh
+# --mem-budget small enough to map the arrays: the suffix array from the
+# external sorts (several runs to merge) gives the same repeats.
+# Usage: mem_budget.sh <findrepset>
+B=$1
+T=$(cd "$(dirname "$0")" && pwd)
+. "$T/gen.sh"
+D=$(mktemp -d) || exit 1
+trap 'rm -rf "$D"' EXIT
+cd "$D" || exit 1
+
+fail=0
+
+# a long repeat takes many doubling rounds
+{ gen 60000 1 "0 97 98 99 100"; gen 60000 1 "0 97 98 99 100"; gen 30000 2 "97 98 10"; } > s
+gen 20000 3 "97 98 99 10" > t
+for opt in "-ml 8" "-nm -ml 8" "-ml 8 -maxl 40" "t -c -ml 6"; do
+	"$B" s $opt -o a 2>/dev/null || fail=1
+	"$B" s $opt --mem-budget 64K -o b 2>/dev/null || fail=1
+	if ! cmp -s a b; then echo "$opt: --mem-budget differs"; fail=1; fi
+done
+
+exit $fail
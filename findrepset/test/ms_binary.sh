@@ -0,0 +1,32 @@
+#!/bin/sh
+# -ms on binary input: 254 and 255 inside the files are plain characters.
+# Usage: ms_binary.sh <findrepset>
+B=$1
+T=$(cd "$(dirname "$0")" && pwd)
+. "$T/gen.sh"
+D=$(mktemp -d) || exit 1
+trap 'rm -rf "$D"' EXIT
+cd "$D" || exit 1
+
+fail=0
+
+# "ab" is the only common part: the 254 closing t is not compared with s
+printf 'xab\376yyab\376q' > s1
+printf 'zab' > t1
+"$B" s1 t1 -c -ml 3 -ms -o o1 2>/dev/null || fail=1
+if [ -s o1 ]; then echo "s1 t1 -c -ms: repeat across the end of t"; fail=1; fi
+
+# 254 in s2 and 254, 255 in t2: -ms is used and gives the same output as
+# without it. -ms never compares the sentinels, the concatenation does:
+# the unique X, Y and Z keep the repeats off the 255 closing s2 and the
+# 254 closing t2.
+{ gen 3000 1 "0 1 65 254"; printf X; } > s2
+{ printf Z; gen 3000 2 "0 1 65 254 255"; printf Y; } > t2
+for opt in "" -c; do
+	"$B" s2 t2 $opt -ml 4 -o a 2>/dev/null || fail=1
+	"$B" s2 t2 $opt -ml 4 -ms -o b 2>e || fail=1
+	if grep -q 'not using -ms' e; then echo "s2 t2 $opt: -ms not used"; fail=1; fi
+	if [ ! -s a ] || ! cmp -s a b; then echo "s2 t2 $opt: -ms differs"; fail=1; fi
+done
+
+exit $fail
@@ -0,0 +1,19 @@
+#!/bin/sh
+# -minocc and -maxocc are rejected with -c, whose repeats are reported once.
+# Usage: occ_common.sh <findrepset>
+B=$1
+D=$(mktemp -d) || exit 1
+trap 'rm -rf "$D"' EXIT
+cd "$D" || exit 1
+
+printf 'abcabcxabc' > s
+printf 'yabcy' > t
+fail=0
+
+for opt in "-minocc 2" "-maxocc 1"; do
+	"$B" s t -c $opt -o o 2>e
+	if [ $? -ne 1 ] || ! grep -q Usage e; then echo "-c $opt: accepted"; fail=1; fi
+	"$B" s t $opt -o o 2>e || { echo "$opt: rejected"; fail=1; }
+done
+
+exit $fail
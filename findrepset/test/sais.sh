@@ -0,0 +1,27 @@
+#!/bin/sh
+# -sais gives the same repeats as prefix doubling, also when the sentinel
+# is not unique and it falls back to bwt().
+# Usage: sais.sh <findrepset>
+B=$1
+T=$(cd "$(dirname "$0")" && pwd)
+. "$T/gen.sh"
+D=$(mktemp -d) || exit 1
+trap 'rm -rf "$D"' EXIT
+cd "$D" || exit 1
+
+fail=0
+
+gen 20000 1 "0 97 98 99 10" > s
+gen 5000 2 "97 98 99 10" > t
+gen 20000 3 "97 98 254 255" > u
+for opt in "s" "s -nm" "s -nm -sortmrs" "s t -c" "s t -c -ms" "u" "u -nm" "u t -c"; do
+	"$B" $opt -ml 5 -o a 2>/dev/null || fail=1
+	"$B" $opt -ml 5 -sais -o b 2>e || fail=1
+	case $opt in
+	u*) grep -q 'using bwt' e || { echo "$opt: -sais did not fall back"; fail=1; } ;;
+	*) ! grep -q 'using bwt' e || { echo "$opt: -sais fell back"; fail=1; } ;;
+	esac
+	if [ ! -s a ] || ! cmp -s a b; then echo "$opt: -sais differs"; fail=1; fi
+done
+
+exit $fail
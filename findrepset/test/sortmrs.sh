@@ -0,0 +1,30 @@
+#!/bin/sh
+# The stack based mrs (-nm) reports the same repeats as the sort based one
+# (-nm -sortmrs), in another order.
+# Usage: sortmrs.sh <findrepset>
+B=$1
+T=$(cd "$(dirname "$0")" && pwd)
+. "$T/gen.sh"
+D=$(mktemp -d) || exit 1
+trap 'rm -rf "$D"' EXIT
+cd "$D" || exit 1
+
+# the records of the output, one per line, sorted; the text has no blank
+# lines, so the records are the paragraphs
+records() {
+	LC_ALL=C awk 'BEGIN { RS = "" } { gsub(/\n/, "|"); print }' "$1" | LC_ALL=C sort
+}
+
+fail=0
+
+{ gen 20000 1 "97 98 99 100 32"; gen 20000 1 "97 98 99 100 32"; gen 10000 2 "97 98 120"; } > s
+gen 5000 3 "97 98 99 32" > t
+for opt in "s" "s t"; do
+	"$B" $opt -nm -ml 5 -o a 2>/dev/null || fail=1
+	"$B" $opt -nm -sortmrs -ml 5 -o b 2>/dev/null || fail=1
+	records a > ra
+	records b > rb
+	if [ ! -s ra ] || ! cmp -s ra rb; then echo "$opt: -sortmrs differs"; fail=1; fi
+done
+
+exit $fail
@@ -0,0 +1,23 @@
+#!/bin/sh
+# -sparse with every position marked as a boundary indexes all the
+# suffixes: the same repeats as without it.
+# Usage: sparse.sh <findrepset>
+B=$1
+T=$(cd "$(dirname "$0")" && pwd)
+. "$T/gen.sh"
+D=$(mktemp -d) || exit 1
+trap 'rm -rf "$D"' EXIT
+cd "$D" || exit 1
+
+fail=0
+
+{ gen 10000 1 "97 98 99 32 10"; gen 10000 1 "97 98 99 32 10"; gen 5000 2 "0 97 98 10"; } > s
+# one bit per byte of s, all set
+LC_ALL=C awk -v n=$(( ($(wc -c < s) + 7) / 8 )) 'BEGIN { for (i = 0; i < n; i++) printf "%c", 255 }' > all
+for opt in "" "-nm" "-clcp" "-threads 3"; do
+	"$B" s $opt -ml 5 -o a 2>/dev/null || fail=1
+	"$B" s $opt -ml 5 -sparse all -o b 2>/dev/null || fail=1
+	if [ ! -s a ] || ! cmp -s a b; then echo "$opt: -sparse differs"; fail=1; fi
+done
+
+exit $fail
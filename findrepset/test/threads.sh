@@ -0,0 +1,22 @@
+#!/bin/sh
+# -threads gives the same repeats as one thread. The text is past the sizes
+# below which the suffix and LCP arrays are built, and mmrs is run,
+# sequentially.
+# Usage: threads.sh <findrepset>
+B=$1
+T=$(cd "$(dirname "$0")" && pwd)
+. "$T/gen.sh"
+D=$(mktemp -d) || exit 1
+trap 'rm -rf "$D"' EXIT
+cd "$D" || exit 1
+
+fail=0
+
+{ gen 100000 1 "0 97 98 99 100 10"; gen 100000 2 "97 98 99 10"; } > s
+for opt in "-nm" "-nm -clcp" "-nm -sais" "" "-clcp"; do
+	"$B" s $opt -ml 8 -o a 2>/dev/null || fail=1
+	"$B" s $opt -ml 8 -threads 3 -o b 2>/dev/null || fail=1
+	if [ ! -s a ] || ! cmp -s a b; then echo "$opt: -threads differs"; fail=1; fi
+done
+
+exit $fail
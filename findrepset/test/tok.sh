@@ -0,0 +1,58 @@
+#!/bin/sh
+# -tok over a text of one-character tokens gives the same repeats as the
+# bytes, in another order, and so does -param without identifiers; the
+# preprocessor lexes 1'000 as one number.
+# Usage: tok.sh <preprocessor> <findrepset>
+P=$1
+B=$2
+T=$(cd "$(dirname "$0")" && pwd)
+. "$T/gen.sh"
+D=$(mktemp -d) || exit 1
+trap 'rm -rf "$D"' EXIT
+cd "$D" || exit 1
+
+# the records of the output without their suffix array interval, one per
+# line, sorted, and their positions sorted; the text has no newlines
+records() {
+	LC_ALL=C awk 'BEGIN { RS = "" } {
+		sub(/\nSuffix array interval[^\n]*/, "")
+		i = index($0, "Text positions of this repeat:")
+		m = split(substr($0, i + 30), q, " ")
+		for (j = 2; j <= m; j++)
+			for (k = j; k > 1 && q[k-1] + 0 > q[k] + 0; k--) { x = q[k]; q[k] = q[k-1]; q[k-1] = x }
+		r = substr($0, 1, i - 1)
+		gsub(/\n/, "|", r)
+		for (j = 1; j <= m; j++) r = r " " q[j]
+		print r
+	}' "$1" | LC_ALL=C sort
+}
+
+fail=0
+
+mkdir src
+# ( ) ; , { } [ ]
+gen 20000 1 "40 41 59 44 123 125 91 93" > src/a.c
+"$P" src x.concat x.charmap --tokens x.tokens >/dev/null 2>&1 || exit 1
+if [ $(wc -c < x.tokens) -lt 80000 ]; then echo "tokens of more than one character"; fail=1; fi
+for opt in "" "-nm" "-clcp" "-threads 3"; do
+	"$B" x.concat $opt -ml 5 -o o 2>/dev/null || fail=1
+	records o > ra
+	"$B" x.concat $opt -ml 5 -tok x.tokens -o o 2>/dev/null || fail=1
+	records o > rb
+	if [ ! -s ra ] || ! cmp -s ra rb; then echo "$opt: -tok differs"; fail=1; fi
+	# no identifiers to rename
+	"$B" x.concat $opt -ml 5 -tok x.tokens -param -o o 2>/dev/null || fail=1
+	records o > rb
+	if ! cmp -s ra rb; then echo "$opt: -tok -param differs"; fail=1; fi
+done
+
+# as many tokens with the digit separators as without them
+for f in "a=1'000;b=0x1'F;c='x';" "a=1000;b=0x1F;c='x';"; do
+	rm -rf src; mkdir src
+	printf '%s\n' "$f" > src/a.c
+	"$P" src y.concat y.charmap --tokens y.tokens >/dev/null 2>&1 || exit 1
+	wc -c < y.tokens
+done > nt
+if [ $(sort -u nt | wc -l) -ne 1 ]; then echo "digit separators split the numbers"; fail=1; fi
+
+exit $fail
@@ -0,0 +1,25 @@
+#!/bin/sh
+# -tok -param: a clone renamed consistently, followed by an inconsistent
+# renaming, is still reported up to where the renaming breaks.
+# Usage: tok_param.sh <preprocessor> <findrepset>
+P=$1
+B=$2
+D=$(mktemp -d) || exit 1
+trap 'rm -rf "$D"' EXIT
+cd "$D" || exit 1
+
+mkdir src
+printf 'int sum(int *arr, int len) { int total = 0; for (int i = 0; i < len; i++) total += arr[i]; return total; }\nx = y;\n' > src/a.c
+printf 'int add(int *vec, int cnt) { int acc = 0; for (int j = 0; j < cnt; j++) acc += vec[j]; return acc; }\np = p;\n' > src/b.c
+"$P" src x.concat x.charmap --tokens x.tokens >/dev/null 2>&1 || exit 1
+fail=0
+
+# the two functions and "\nx =" / "\np =": 110 bytes at 0 and 114
+for opt in -nm ""; do
+	"$B" x.concat -tok x.tokens -param $opt -ml 10 -o o 2>/dev/null || fail=1
+	if ! grep -q '^Repeat size: 110$' o || ! grep -q '^Text positions of this repeat:  0 114$' o; then
+		echo "-param $opt: clone not reported"; fail=1
+	fi
+done
+
+exit $fail
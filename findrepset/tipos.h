@@ -8,6 +8,18 @@ typedef unsigned short ushort;
 typedef unsigned int uint;
 typedef unsigned long long uint64;
 
+/* Text positions, lengths and suffix array entries.
+ * LARGE_INDEX builds use 64 bits so the input can exceed 4 GiB. */
+#ifdef LARGE_INDEX
+typedef uint64 uidx;
+typedef long long sidx;
+#define UIDX_FMT "%llu"
+#else
+typedef uint uidx;
+typedef int sidx;
+#define UIDX_FMT "%u"
+#endif
+
 #ifndef bool
 typedef uint bool;
 #endif
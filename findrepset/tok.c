@@ -0,0 +1,203 @@
+#include "tok.h"
+#include "sais.h"
+#include "common.h"
+#include "emem.h"
+#include "macros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NONE ((uidx)-1)
+
+bool tok_load(tok_stream* ts, const char* fn, uidx n) {
+	uchar *ids, *map;
+	char* mn;
+	uidx ni, nm, k;
+	bool im, mm, ok;
+	memset(ts, 0, sizeof(tok_stream));
+	mn = (char*)pz_malloc(strlen(fn) + 5);
+	sprintf(mn, "%s.map", fn);
+	ids = mapStrFileExtraSpace(fn, &ni, 0, &im);
+	map = ids ? mapStrFileExtraSpace(mn, &nm, 0, &mm) : NULL;
+	ok = ids && map && ni % sizeof(uint) == 0 && nm == ni / sizeof(uint) * 2 * sizeof(uint64);
+	if (ids && map && !ok) fprintf(stderr, "Tokens %s do not match %s\n", fn, mn);
+	if (ok) {
+		ts->m = ni / sizeof(uint) + 1;
+		ts->t = (uidx*)emem_malloc(ts->m * sizeof(uidx));
+		ts->sp = (uint64*)emem_malloc(2 * ts->m * sizeof(uint64));
+		memcpy(ts->sp, map, nm);
+		forn(k, ts->m-1) {
+			memcpy(&ts->t[k], ids + k * sizeof(uint), sizeof(uint));
+			if (ts->t[k] >= ts->K) ts->K = ts->t[k] + 1;
+			if (ts->sp[2*k+1] > n-1) ok = FALSE;
+		}
+		ts->t[ts->m-1] = ts->K++;
+		ts->sp[2*(ts->m-1)] = ts->sp[2*(ts->m-1)+1] = n-1;
+		if (!ok) {
+			fprintf(stderr, "Tokens %s go beyond the input\n", fn);
+			tok_free(ts);
+		}
+	}
+	if (map) unmapStrFile(map, nm, 0, mm);
+	if (ids) unmapStrFile(ids, ni, 0, im);
+	pz_free(mn);
+	return ok;
+}
+
+void tok_free(tok_stream* ts) {
+	emem_free(ts->t);
+	emem_free(ts->id);
+	emem_free(ts->sp);
+	memset(ts, 0, sizeof(tok_stream));
+}
+
+void tok_sa(tok_stream* ts, uidx* r, uidx* p, left_ctx* lc) {
+	uidx i, j, k, l, m = ts->m;
+	uidx* t = ts->t;
+	sais_int(t, r, m, ts->K);
+
+	memset(lc, 0, sizeof(left_ctx));
+	lc->lid = (uidx*)emem_malloc(m * sizeof(uidx));
+	lc->nid = ts->K;
+	forn(i, m) {
+		if (r[i]) lc->lid[i] = t[r[i]-1];
+		else { lc->lid[i] = 0; lc->prim = i; }
+	}
+
+	/* Phi, then the PLCP in place */
+	p[r[0]] = NONE;
+	forsn(i, 1, m) p[r[i]] = r[i-1];
+	l = 0;
+	forn(j, m) {
+		if ((k = p[j]) == NONE) l = 0;
+		else while (j+l < m && k+l < m && t[j+l] == t[k+l]) ++l;
+		p[j] = l;
+		if (l) --l;
+	}
+}
+
+void tok_callback(uidx l, uidx i, uidx n, void* tdata) {
+	tok_data* td = (tok_data*)tdata;
+	uidx k = td->r[i];
+	uint64 lb = td->ts->sp[2*(k+l-1)+1] - td->ts->sp[2*k];
+	if (l && lb >= td->ml) td->callback(lb, i, n, td->data);
+}
+
+/*** Parameterized matching ***/
+
+void tok_param(tok_stream* ts) {
+	uidx k, m = ts->m;
+	ts->id = (uidx*)emem_malloc(m * sizeof(uidx));
+	memcpy(ts->id, ts->t, m * sizeof(uidx));
+	/* the identifiers become K-1 (the sentinel so far), the sentinel K */
+	forn(k, m-1) if (ts->t[k] & 1) ts->t[k] = ts->K-1;
+	ts->t[m-1] = ts->K++;
+}
+
+void tok_param_init(tok_param_data* pd, tok_stream* ts, uidx* r, pidx* pr, lcp_array* h,
+		 output_callback* callback, void* data) {
+	memset(pd, 0, sizeof(tok_param_data));
+	pd->ts = ts; pd->r = r; pd->pr = pr; pd->h = h;
+	pd->callback = callback; pd->data = data;
+	pd->last = (uidx*)pz_malloc(ts->K * sizeof(uidx));
+	pd->stamp = (uidx*)pz_malloc(ts->K * sizeof(uidx));
+	memset(pd->stamp, 0, ts->K * sizeof(uidx));
+}
+
+void tok_param_free(tok_param_data* pd) {
+	free(pd->enc);
+	free(pd->ord);
+	free(pd->tr);
+	free(pd->pe);
+	free(pd->sl);
+	free(pd->sb);
+	free(pd->qa);
+	free(pd->qt);
+	free(pd->tp);
+	pz_free(pd->last);
+	pz_free(pd->stamp);
+}
+
+void tok_param_callback(uidx l, uidx i, uidx n, void* pdata) {
+	tok_param_data* pd = (tok_param_data*)pdata;
+	uidx j, k, x, v, b, lp = 0, top, *e, *f, *id = pd->ts->id;
+	if (!l) return;
+	if (n * l > pd->esz) {
+		pd->esz = n * l;
+		pd->enc = (uidx*)pz_realloc(pd->enc, pd->esz * sizeof(uidx));
+	}
+	if (n > pd->osz) {
+		pd->osz = n;
+		pd->ord = (uidx*)pz_realloc(pd->ord, n * sizeof(uidx));
+		pd->tr = (uidx*)pz_realloc(pd->tr, n * sizeof(uidx));
+		pd->pe = (uidx*)pz_realloc(pd->pe, n * sizeof(uidx));
+		pd->sl = (uidx*)pz_realloc(pd->sl, (n+1) * sizeof(uidx));
+		pd->sb = (uidx*)pz_realloc(pd->sb, (n+1) * sizeof(uidx));
+		pd->qa = (qpair*)pz_realloc(pd->qa, n * sizeof(qpair));
+		pd->qt = (qpair*)pz_realloc(pd->qt, n * sizeof(qpair));
+		pd->tp = (pidx*)pz_realloc(pd->tp, n * PIDX_BYTES);
+	}
+
+	/* Prev-encoding of the l first tokens of each suffix: the distance to
+	 * the previous use of each identifier inside them, 0 elsewhere (the
+	 * skeleton is the same for all of them) */
+	forn(k, n) {
+		e = pd->enc + k * l;
+		++pd->st;
+		forn(j, l) {
+			x = id[pd->r[i+k] + j];
+			e[j] = 0;
+			if (!(x & 1)) continue;
+			if (pd->stamp[x] == pd->st) e[j] = j - pd->last[x];
+			pd->stamp[x] = pd->st;
+			pd->last[x] = j;
+		}
+		pd->ord[k] = k;
+	}
+	/* sorted by their encodings, LSD: a stable sort per token, last first */
+	for(j = l; j-- > 0;) {
+		forn(k, n) QP_SET(&pd->qa[k], pd->enc[pd->ord[k] * l + j], pd->ord[k]);
+		radix_pairs(pd->qa, pd->qt, n);
+		forn(k, n) pd->ord[k] = QP_IDX(&pd->qa[k]);
+	}
+
+	forn(k, n) {
+		pd->tr[k] = pd->r[i + pd->ord[k]];
+		pidx_set(pd->tp, k, pidx_get(pd->pr, i + pd->ord[k]));
+	}
+	forn(k, n) {
+		pd->r[i+k] = pd->tr[k];
+		pidx_set(pd->pr, i+k, pidx_get(pd->tp, k));
+	}
+
+	/* pe[k]: tokens over which the k-th encoding agrees with the one before */
+	forsn(k, 1, n) {
+		e = pd->enc + pd->ord[k-1] * l;
+		f = pd->enc + pd->ord[k] * l;
+		for(j = 0; j < l && e[j] == f[j]; ++j);
+		pd->pe[k] = j;
+	}
+	/* the matches shorter than the enclosing repeat are found from it */
+	if (pd->h) {
+		if (i > 0) lp = lcpa_get(pd->h, i-1);
+		if (i+n < pd->ts->m && lcpa_get(pd->h, i+n-1) > lp) lp = lcpa_get(pd->h, i+n-1);
+	}
+	/* Every group of two or more agreeing on their first v tokens, and not
+	 * on v+1, is a match of v tokens: the lcp-intervals of pe, bottom-up */
+	top = 0;
+	pd->sl[0] = 0; pd->sb[0] = 0;
+	forsn(k, 1, n+1) {
+		v = k < n ? pd->pe[k] : 0;
+		b = k-1;
+		while (v < pd->sl[top]) {
+			b = pd->sb[top];
+			if (pd->sl[top] > lp) pd->callback(pd->sl[top], i+b, k-b, pd->data);
+			--top;
+		}
+		if (v > pd->sl[top]) {
+			++top;
+			pd->sl[top] = v; pd->sb[top] = b;
+		}
+	}
+}
@@ -0,0 +1,93 @@
+#ifndef __TOK_H__
+#define __TOK_H__
+
+#include "tipos.h"
+#include "bwt.h"
+#include "output_callbacks.h"
+#include "radix.h"
+#include "lcp.h"
+
+/** Token streams: the text lexed by the preprocessor (--tokens) into
+ * 32-bit ids, and the byte range of each token in the text.
+ *
+ * The file fn holds one id per token (native byte order) and fn.map two
+ * native 64-bit offsets per token, its start and end in the text. An id is
+ * (index << 1) | identifier; the indexes below the number of files minus
+ * one separate them, so no repeat spans two files.
+ * The suffix array, LCP and repeats are computed over the ids; the
+ * repeats are then given back in bytes (see tok_callback()).
+ */
+
+typedef struct {
+	uidx m;        /* tokens, plus the sentinel */
+	uidx K;        /* ids are in [0, K), the sentinel is K-1 */
+	uidx* t;       /* the ids, t[m-1] being the sentinel */
+	uidx* id;      /* after tok_param(), the ids, t holding the skeleton */
+	uint64* sp;    /* sp[2k] and sp[2k+1]: byte range of the token k */
+} tok_stream;
+
+/** Loads the tokens of a text of n bytes (the last one being the sentinel,
+ * where the token sentinel starts). Returns FALSE on error. */
+bool tok_load(tok_stream* ts, const char* fn, uidx n);
+void tok_free(tok_stream* ts);
+
+/** Parameterized matching: t becomes the skeleton of the stream, every
+ * identifier replaced by one new symbol, and the ids move to id.
+ * Call before tok_sa(). */
+void tok_param(tok_stream* ts);
+
+/** Suffix array r of the ids of ts, their PLCP p (as lcp_plcp() leaves it,
+ * in tokens) and the previous id of each suffix in lc->lid (allocated with
+ * emem_malloc()). */
+void tok_sa(tok_stream* ts, uidx* r, uidx* p, left_ctx* lc);
+
+/** Turns repeats of tokens into repeats of bytes */
+typedef struct {
+	tok_stream* ts;
+	uidx* r;               /* the token suffix array */
+	uidx ml;               /* minimum length in bytes */
+	output_callback* callback;
+	void* data;
+} tok_data;
+
+/** An output_callback taking l in tokens and calling tdata->callback with
+ * the bytes covered by the first suffix of the interval, if they are at
+ * least tdata->ml. The suffix array given to the next callback must hold
+ * the byte positions of the suffixes. */
+void tok_callback(uidx l, uidx i, uidx n, void* tdata);
+
+/** Splits the repeats of the skeleton in parameterized matches */
+typedef struct {
+	tok_stream* ts;
+	uidx* r;               /* the token suffix array */
+	pidx* pr;              /* the byte suffix array, permuted along r */
+	lcp_array* h;          /* lcp of r, if the kernel reports the enclosing
+	                        * repeats too (mrs, smrs), else NULL */
+	output_callback* callback;
+	void* data;
+	uidx *enc, esz;        /* prev-encodings of the suffixes of an interval */
+	uidx *ord, *tr, osz;
+	uidx *pe, *sl, *sb;    /* lcp of the sorted encodings, and a stack */
+	qpair *qa, *qt;        /* to sort them, a column at a time */
+	pidx* tp;
+	uidx *last, *stamp, st;/* last use of each id, valid if stamp is st */
+} tok_param_data;
+
+void tok_param_init(tok_param_data* pd, tok_stream* ts, uidx* r, pidx* pr, lcp_array* h,
+		 output_callback* callback, void* data);
+void tok_param_free(tok_param_data* pd);
+
+/** An output_callback over the skeleton. Two suffixes of the interval are a
+ * parameterized match over v <= l tokens when each identifier of their
+ * first v tokens is at the same distance from the previous use of that
+ * identifier (or is the first use in both), that is, when one is the
+ * other with the identifiers consistently renamed. Reorders r and pr
+ * inside the interval by these distances and calls pdata->callback for
+ * every group of two or more at the longest v they share, so a renaming
+ * broken near the end still reports the match before it. With h, the
+ * groups no longer than the repeat enclosing the interval are left to it.
+ * The kernels of mrs.h and mmrs.h do not read r, and read the left
+ * context of an interval before reporting it. */
+void tok_param_callback(uidx l, uidx i, uidx n, void* pdata);
+
+#endif //__TOK_H__
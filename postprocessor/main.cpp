@@ -1,5 +1,6 @@
 #include <iostream>
 #include <algorithm>
+#include <unordered_map>
 #include <unordered_set>
 #include <optional>
 #include "../util/stringescape.h"
@@ -19,18 +20,43 @@ struct ProcessingOptions {
     bool compress;
     std::string bwt_file;
     std::string json_file;
+    std::string concat_file;
+    bool whole_files;
+    std::string tokens_file;
 };
 
+// byte range of each token of the preprocessor's --tokens (the .map file)
+struct TokenMap {
+    std::vector<uint64_t> start, end;
 
+    bool load(const std::string &map_file) {
+        std::ifstream in(map_file, std::ios::binary);
+        uint64_t range[2];
+        while (in.read((char *) range, sizeof(range))) {
+            start.push_back(range[0]);
+            end.push_back(range[1]);
+        }
+        return in.eof() && in.gcount() == 0;
+    }
+
+    // token holding the byte pos (separators are empty, so the token after them)
+    size_t index(unsigned long pos) const {
+        return std::upper_bound(start.begin(), start.end(), pos) - start.begin() - 1;
+    }
+};
+
+
+template<typename Positions>
 void
-emit_verbose_repeat(std::ostream &json_out, const std::string &subtext, const std::unordered_set<unsigned long> &positions,
+emit_verbose_repeat(std::ostream &json_out, const std::string &subtext, const Positions &positions,
                     const CharMap &charmap,
-                    const std::map<unsigned long, unsigned long> &linemap) {
+                    const std::map<unsigned long, unsigned long> &linemap,
+                    const std::vector<unsigned long> *ends = nullptr) {
     json_out << "{\"text\": ";
     write_escaped_string(json_out, subtext);
     json_out << ",\"locations\": [";
     bool print_separator = false;
-    
+    size_t k = 0;
  
     for (unsigned long start_pos : positions) {
         if (print_separator) json_out << ",";
@@ -39,7 +65,8 @@ emit_verbose_repeat(std::ostream &json_out, const std::string &subtext, const st
         auto start_line = (--linemap.upper_bound(start_pos))->second;
         json_out << "{\"path\":\t\"" << filename << "\",\t";
         json_out << "\"start_line\": " << start_line << ",\t";
-        unsigned long end_pos = start_pos + subtext.length() - 1; // if length == 1, end_pos == start_pos
+        // if length == 1, end_pos == start_pos
+        unsigned long end_pos = ends ? (*ends)[k++] - 1 : start_pos + subtext.length() - 1;
         auto end_line = (--linemap.upper_bound(end_pos))->second;
         json_out << "\"end_line\":\t" << end_line << "}";
         print_separator = true;
@@ -94,9 +121,68 @@ process_position(const CharMap &charmap, Repeats &repeats, std::string subtext,
     } while (!subtext.empty());
 }
 
+// destination of the repeats read: split at file boundaries and merged by text (default), or, with
+// --whole-files (findrepset -files: no repeat spans two files), written out as they are read
+struct RepeatSink {
+    const CharMap &charmap;
+    const std::map<unsigned long, unsigned long> &linemap;
+    const ProcessingOptions &opts;
+    std::ostream &json_out;
+    const TokenMap *tokens;
+    Repeats repeats;
+    std::vector<unsigned long> positions, ends;
+    bool print_obj_separator = false;
+
+    RepeatSink(const CharMap &charmap, const std::map<unsigned long, unsigned long> &linemap,
+               const ProcessingOptions &opts, std::ostream &json_out, const TokenMap *tokens)
+            : charmap(charmap), linemap(linemap), opts(opts), json_out(json_out), tokens(tokens) {
+    }
+
+    void add(std::string &subtext) {
+        if (tokens) {
+            // the occurrences cover the same tokens as the first one, which subtext comes from
+            if (positions.size() > 1 && !should_skip(subtext, opts)) {
+                size_t first = tokens->index(positions[0]);
+                size_t count = tokens->index(positions[0] + subtext.size() - 1) - first + 1;
+                for (unsigned long pos : positions) {
+                    ends.push_back(tokens->end[tokens->index(pos) + count - 1]);
+                }
+                if (print_obj_separator) json_out << "\n";
+                emit_verbose_repeat(json_out, subtext, positions, charmap, linemap, &ends);
+                print_obj_separator = true;
+                ends.clear();
+            }
+        } else if (!opts.whole_files) {
+            for (unsigned long pos : positions) {
+                process_position(charmap, repeats, subtext, pos, opts);
+            }
+        } else if (positions.size() > 1 && !should_skip(subtext, opts)) {
+            emit(subtext, positions);
+        }
+        positions.clear();
+    }
+
+    template<typename Positions>
+    void emit(const std::string &subtext, const Positions &pos) {
+        if (print_obj_separator) json_out << "\n";
+        emit_verbose_repeat(json_out, subtext, pos, charmap, linemap);
+        print_obj_separator = true;
+    }
+
+    // output repeats: we know which subtexts come from splits, we can guarantee they all get merged
+    void finish() {
+        for (const auto &repeat : repeats) {
+            // after split, some "repeated sequences" may actually have a single occurrence
+            if (repeat.second.size() > 1) {
+                emit(repeat.first, repeat.second);
+            }
+        }
+    }
+};
+
 // custom extractor for objects of type RepeatEntry
 void
-read(std::istream &is, Repeats &repeats, const CharMap &charmap, const ProcessingOptions &opts) {
+read(std::istream &is, RepeatSink &sink) {
     std::istream::sentry s(is);
     std::string line;
 
@@ -146,9 +232,67 @@ read(std::istream &is, Repeats &repeats, const CharMap &charmap, const Processin
         for (unsigned long i = 0; i < repeat_occurrences; i++) {
             unsigned long pos;
             is >> pos;
-            
-            process_position(charmap, repeats, repeat_subtext, pos, opts);
+            sink.positions.push_back(pos);
+        }
+        // in text order, as in the binary stream, so -b gives the same output; the token
+        // repeats need the position the subtext comes from first (they are never binary)
+        if (!sink.tokens) {
+            std::sort(sink.positions.begin(), sink.positions.end());
+        }
+        sink.add(repeat_subtext);
+    }
+}
+
+// reads an unsigned LEB128 varint, false at the end of the stream
+bool
+read_varint(std::istream &is, unsigned long &x) {
+    int c, shift = 0;
+    x = 0;
+    while ((c = is.get()) != EOF) {
+        x |= (unsigned long) (c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            return true;
+        }
+        shift += 7;
+    }
+    return false;
+}
+
+// reader for the binary stream of findrepset -b (see findrepset/output_callbacks.h);
+// the repeated text is read from the concatenated input at its first position
+void
+read_binary(std::istream &is, RepeatSink &sink, std::istream &concat) {
+    char magic[8];
+
+    if (!is.read(magic, sizeof(magic)) || std::string(magic, 7) != "FRSREPB") {
+        throw std::runtime_error("Expected a binary repeat stream");
+    }
+    if (magic[7] != 1) {
+        throw std::runtime_error("Unsupported binary repeat stream version " + std::to_string((int) magic[7]));
+    }
+
+    unsigned long repeat_size, sa_index, repeat_occurrences, delta;
+    while (read_varint(is, repeat_size)) {
+        if (!read_varint(is, sa_index) || !read_varint(is, repeat_occurrences)) {
+            throw std::runtime_error("Truncated repeat record");
+        }
+        unsigned long pos = 0;
+        std::string repeat_subtext;
+        for (unsigned long i = 0; i < repeat_occurrences; i++) {
+            if (!read_varint(is, delta)) {
+                throw std::runtime_error("Truncated repeat record");
+            }
+            pos += delta;
+            if (i == 0) {
+                repeat_subtext.resize(repeat_size);
+                concat.seekg(pos);
+                if (!concat.read(&repeat_subtext[0], repeat_size)) {
+                    throw std::runtime_error("Repeat out of the bounds of " + sink.opts.concat_file);
+                }
+            }
+            sink.positions.push_back(pos);
         }
+        sink.add(repeat_subtext);
     }
 }
 
@@ -156,7 +300,11 @@ read(std::istream &is, Repeats &repeats, const CharMap &charmap, const Processin
 int main(int argc, char **argv) {
     if (argc < 4) {
         std::cout << "\nUsage:\t" << argv[0]
-                  << "\t<bwt_output>\t<charmap_file>\t<linemap_file>\t<output_file>\t[<options...>]\n";
+                  << "\t<bwt_output>\t<charmap_file>\t<linemap_file>\t<output_file>\t[<options...>]\n"
+                  << "\t--concat <concat_file>\treads <bwt_output> as the binary stream of findrepset -b\n"
+                  << "\t--whole-files\trepeats never span files (findrepset -files): write them as they are read\n"
+                  << "\t--tokens <map_file>\trepeats of findrepset -tok, <map_file> being the token map of the\n"
+                  << "\t\tpreprocessor (implies --whole-files)\n";
         exit(1);
     }
 
@@ -212,11 +360,29 @@ int main(int argc, char **argv) {
             args.cmdOptionExists("--skip-null"),
             args.cmdOptionExists("--compress"),
             bwt_file,
-            json_file
+            json_file,
+            args.getCmdArg("--concat").value_or(""),
+            args.cmdOptionExists("--whole-files"),
+            args.getCmdArg("--tokens").value_or("")
     };
 
+    TokenMap tokens;
+    if (!opts.tokens_file.empty() && !tokens.load(opts.tokens_file)) {
+        std::cerr << "tokens map file read fails. exit.\n";
+        exit(1);
+    }
+
+    std::unique_ptr<std::ostream> json_outp(
+            opts.compress ? (std::ostream *) new zstr::ofstream(opts.json_file) : new std::ofstream(opts.json_file));
+    std::ostream &json_out = *json_outp;
+
+    if (!json_out) {
+        std::cerr << "JSON output file open fails. exit.\n";
+        exit(1);
+    }
+
     // first pass: colecting repeats splitting if necessary
-    Repeats repeats;
+    RepeatSink sink{charmap, linemap, opts, json_out, opts.tokens_file.empty() ? nullptr : &tokens};
 
     std::unique_ptr<std::istream> bwtp(
             opts.compress ? (std::istream *) new zstr::ifstream(opts.bwt_file) : new std::ifstream(opts.bwt_file));
@@ -226,33 +392,28 @@ int main(int argc, char **argv) {
         std::cerr << "bwt input file open fails. exit.\n";
         exit(1);
     }
+    std::ifstream concat_in;
+    if (!opts.concat_file.empty()) {
+        concat_in.open(opts.concat_file, std::ios::binary);
+        if (!concat_in) {
+            std::cerr << "concat file open fails. exit.\n";
+            exit(1);
+        }
+    }
     try {
-        while (bwt_in) {
-            read(bwt_in, repeats, charmap, opts);
+        if (!opts.concat_file.empty()) {
+            read_binary(bwt_in, sink, concat_in);
+        } else {
+            while (bwt_in) {
+                read(bwt_in, sink);
+            }
         }
     } catch (std::runtime_error &e) {
         std::cerr << "Failed to read repeat entry at position " << bwt_in.tellg() << " in " << opts.bwt_file << ": "
                   << e.what();
     }
     
-    // preparation for second pass
-    std::unique_ptr<std::ostream> json_outp(
-            opts.compress ? (std::ostream *) new zstr::ofstream(opts.json_file) : new std::ofstream(opts.json_file));
-    std::ostream &json_out = *json_outp;
-
-    if (!json_out) {
-        std::cerr << "JSON output file open fails. exit.\n";
-        exit(1);
-    }
-    bool print_obj_separator = false;
-    // output repeats: we know which subtexts come from splits, we can guarantee they all get merged
-    for (const auto &repeat : repeats) {
-        // after split, some "repeated sequences" may actually have a single occurrence
-        if (repeat.second.size() > 1) {
-            if (print_obj_separator) json_out << "\n";
-                emit_verbose_repeat(json_out, repeat.first, repeat.second, charmap, linemap);
-            print_obj_separator = true;
-        }
-    }
+    // second pass: merged repeats
+    sink.finish();
     return 0;
 }
@@ -1,8 +1,11 @@
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 #include <filesystem>
 #include <set>
 #include <optional>
+#include <unordered_map>
+#include <unordered_set>
 #include "../util/ArgParser.h"
 
 namespace fs = std::filesystem;
@@ -22,6 +25,157 @@ bool endsWith(std::string const &fullString, std::string const &ending) {
     }
 }
 
+enum char_class {
+    blank, word, punct
+};
+
+char_class classify(unsigned char c) {
+    if (std::isspace(c)) return blank;
+    if (std::isalnum(c) || c == '_' || c >= 128) return word;
+    return punct;
+}
+
+// Marks in a bitvector (bit i&7 of byte i>>3) the offsets of concat_file where a
+// line starts, and also a token (a run of word characters or a single punctuation
+// character) unless lines_only. Each mark depends only on the byte at the offset
+// and the one before, as findrepset -sparse requires.
+bool write_bounds(const std::string &concat_file, const std::string &bounds_file, bool lines_only) {
+    std::ifstream in(concat_file, std::ifstream::binary);
+    std::ofstream bounds(bounds_file, std::ofstream::binary);
+    if (!in || !bounds) return false;
+
+    std::vector<char> buf(1 << 20);
+    std::vector<char> bits(buf.size() / 8);
+    int prev = -1;
+    size_t fill = 0;
+    unsigned bit = 0;
+    while (in) {
+        in.read(buf.data(), buf.size());
+        size_t got = in.gcount();
+        for (size_t i = 0; i < got; ++i) {
+            unsigned char c = buf[i];
+            bool mark = prev == -1 || prev == '\n';
+            if (!mark && !lines_only) {
+                char_class k = classify(c);
+                mark = k != blank && (k == punct || k != classify(prev));
+            }
+            if (mark) bits[fill] |= char(1u << bit);
+            if (++bit == 8) {
+                bit = 0;
+                if (++fill == bits.size()) {
+                    bounds.write(bits.data(), fill);
+                    std::fill(bits.begin(), bits.end(), 0);
+                    fill = 0;
+                }
+            }
+            prev = c;
+        }
+    }
+    bounds.write(bits.data(), fill + (bit != 0));
+    return bool(bounds);
+}
+
+// operators of C, C++ and Java longer than one character, longest first
+static const char *const OPERATORS[] = {
+        ">>>=", "<<=", ">>=", ">>>", "...", "->*", "<=>", "->", "++", "--", "<<", ">>", "<=", ">=", "==", "!=",
+        "&&", "||", "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", "::", ".*", "##"
+};
+
+// keywords of C, C++ and Java, the identifiers that are not renamable
+static const std::unordered_set<std::string> KEYWORDS = {
+        "abstract", "alignas", "alignof", "asm", "assert", "auto", "bool", "boolean", "break", "byte", "case",
+        "catch", "char", "class", "const", "const_cast", "constexpr", "continue", "decltype", "default", "delete",
+        "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extends", "extern", "false",
+        "final", "finally", "float", "for", "friend", "goto", "if", "implements", "import", "inline",
+        "instanceof", "int", "interface", "long", "mutable", "namespace", "native", "new", "noexcept",
+        "nullptr", "null", "operator", "package", "private", "protected", "public", "register",
+        "reinterpret_cast", "restrict", "return", "short", "signed", "sizeof", "static", "static_assert",
+        "static_cast", "strictfp", "struct", "super", "switch", "synchronized", "template", "this", "throw",
+        "throws", "transient", "true", "try", "typedef", "typeid", "typename", "union", "unsigned", "using",
+        "var", "virtual", "void", "volatile", "while", "_Bool", "_Complex", "_Generic", "_Noreturn",
+        "_Static_assert", "_Thread_local"
+};
+
+bool is_ident(unsigned char c) {
+    return std::isalnum(c) || c == '_' || c == '$' || c >= 128;
+}
+
+// End of the C/C++/Java token starting at b[i], which is not blank nor a comment: an identifier
+// or keyword, a number, a string or character literal, an operator or any other single character
+size_t lex_token(const std::string &b, size_t i) {
+    size_t n = b.size(), j = i + 1;
+    unsigned char c = b[i];
+    if (is_ident(c) && !std::isdigit(c)) {
+        while (j < n && is_ident(b[j])) j++;
+    } else if (std::isdigit(c) || (c == '.' && j < n && std::isdigit((unsigned char) b[j]))) {
+        // a ' between digits is a C++14 digit separator (1'000, 0xFF'FF), not a char literal
+        while (j < n && (is_ident(b[j]) || b[j] == '.' ||
+                         ((b[j] == '+' || b[j] == '-') && std::strchr("eEpP", b[j - 1])) ||
+                         (b[j] == '\'' && j + 1 < n && std::isxdigit((unsigned char) b[j + 1]) &&
+                          std::isxdigit((unsigned char) b[j - 1])))) j++;
+    } else if (c == '"' || c == '\'') {
+        while (j < n && b[j] != c && b[j] != '\n') j += b[j] == '\\' ? 2 : 1;
+        j = std::min(j + 1, n);
+    } else {
+        for (const char *op : OPERATORS) {
+            size_t l = std::strlen(op);
+            if (b.compare(i, l, op) == 0) return i + l;
+        }
+    }
+    return j;
+}
+
+// Lexes concat_file into tokens_file, one 32-bit id per token in native byte order, and writes to
+// tokens_file + ".map" the byte range [start, end) of each token as two native 64-bit offsets.
+// An id is (index << 1) | identifier, the low bit marking the renamable identifiers (not keywords).
+// Indexes 0..files-2 separate the files (one before each file but the first, with an empty range at
+// its start), the lexemes follow interned by their text. Blanks and comments are skipped.
+bool write_tokens(const std::string &concat_file, const std::vector<unsigned long> &file_starts,
+                  unsigned long concat_size, const std::string &tokens_file) {
+    std::ifstream in(concat_file, std::ifstream::binary);
+    std::ofstream tokens(tokens_file, std::ofstream::binary);
+    std::ofstream map(tokens_file + ".map", std::ofstream::binary);
+    if (!in || !tokens || !map) return false;
+
+    std::unordered_map<std::string, uint32_t> ids;
+    uint32_t first_id = file_starts.empty() ? 0 : file_starts.size() - 1;
+    std::string b;
+    auto emit = [&](uint32_t id, uint64_t start, uint64_t end) {
+        tokens.write((const char *) &id, sizeof(id));
+        map.write((const char *) &start, sizeof(start));
+        map.write((const char *) &end, sizeof(end));
+    };
+
+    for (size_t f = 0; f < file_starts.size(); f++) {
+        unsigned long start = file_starts[f];
+        unsigned long end = f + 1 < file_starts.size() ? file_starts[f + 1] : concat_size;
+        if (f > 0) emit((f - 1) << 1, start, start);
+        b.resize(end - start);
+        in.seekg(start);
+        in.read(b.data(), b.size());
+        for (size_t i = 0; i < b.size();) {
+            if (std::isspace((unsigned char) b[i])) {
+                i++;
+            } else if (b.compare(i, 2, "//") == 0) {
+                i = b.find('\n', i);
+                if (i == std::string::npos) i = b.size();
+            } else if (b.compare(i, 2, "/*") == 0) {
+                i = b.find("*/", i + 2);
+                i = i == std::string::npos ? b.size() : i + 2;
+            } else {
+                size_t j = lex_token(b, i);
+                std::string lexeme = b.substr(i, j - i);
+                bool ident = is_ident(lexeme[0]) && !std::isdigit((unsigned char) lexeme[0]) &&
+                             !KEYWORDS.count(lexeme);
+                auto it = ids.emplace(std::move(lexeme), (first_id + ids.size()) << 1 | ident).first;
+                emit(it->second, start + i, start + j);
+                i = j;
+            }
+        }
+    }
+    return bool(tokens) && bool(map);
+}
+
 int main(int argc, char **argv) {
     if (argc < 4) {
         std::cout << "\nUsage:\t"<< argv[0] << "\t<input_directory>\t<output_file>\t<charmap_file>\t[<options...>]\n";
@@ -45,6 +199,10 @@ int main(int argc, char **argv) {
     bool delcmts = args.cmdOptionExists("--delete-comments");
     std::optional<std::vector<std::string>> file_extensions = args.getCmdArgs("--extensions");
     std::optional<std::string> linemap_file = args.getCmdArg("--linemap");
+    std::optional<std::string> bounds_file = args.getCmdArg("--bounds");
+    bool bounds_lines = args.cmdOptionExists("--bounds-lines");
+    std::optional<std::string> tokens_file = args.getCmdArg("--tokens");
+    std::vector<unsigned long> file_starts;
 
     std::string out_file = argv[2];
     std::string charmap_file = argv[3];
@@ -103,6 +261,7 @@ int main(int argc, char **argv) {
         }
 
         charmap << out.tellp() << "\t" << file.path().string() << "\n";
+        file_starts.push_back(out.tellp());
         if (linemap) {
             *linemap << out.tellp() << "\t" << 1 << "\n";
         }
@@ -237,10 +396,21 @@ int main(int argc, char **argv) {
     }
 
     charmap << out.tellp() << "\t\n";   // blank file name == end
+    unsigned long out_size = out.tellp();
     fs::resize_file(out_file, out.tellp()); // pubseekoff operations can lead to ghost data
     out.close();
     charmap.close();
     if (linemap) linemap->close();
 
+    if (tokens_file && !write_tokens(out_file, file_starts, out_size, *tokens_file)) {
+        std::cerr << "tokens output file write fails. exit.\n";
+        exit(1);
+    }
+
+    if (bounds_file && !write_bounds(out_file, *bounds_file, bounds_lines)) {
+        std::cerr << "bounds output file write fails. exit.\n";
+        exit(1);
+    }
+
     std::cout << "\nDone!\n";
 }